@@ -1,4 +1,5 @@
 ﻿#include "ImagePixelViewer.h"
+#include "tinyfiledialogs.h"
 
 int ImagePixelViewer() {
 
@@ -71,8 +72,19 @@ int ImagePixelViewer() {
 	states.Auto_Maximize_Contrast_Last = states.Auto_Maximize_Contrast;
 	states.One_Channel_Pseudo_Color_Last = states.One_Channel_Pseudo_Color;
 	states.Four_Channel_Ignore_Alpha_Last = states.Four_Channel_Ignore_Alpha;
+	states.Pyramid_Keep_Extremes_Last = states.Pyramid_Keep_Extremes;
 	glfwSetWindowUserPointer(window, &states);
 	glfwSetDropCallback(window, drop_callback);
+	GLint maxTextureSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	if (maxTextureSize > 0) {
+		states.tiles.tileSize = std::min(kTileSize, (int)maxTextureSize);
+		states.thumbs.pageSize = std::min(kThumbAtlasPageSize, (int)maxTextureSize);
+	}
+	init_tiff_reader();
+	start_worker_pool(states.decoder.pool, default_worker_count());
+	submit_job(states.decoder.pool, prune_thumbnail_cache);
+	start_file_watcher(states.watcher);
 
 
 	ImVec4 clear_color = ImVec4(0.08f, 0.09f, 0.11f, 1.0f);
@@ -81,17 +93,72 @@ int ImagePixelViewer() {
 
 
 	while (!glfwWindowShouldClose(window)) {
-		glfwPollEvents();
+		// Idle: sleep until input arrives or a worker/watcher thread posts an empty event.
+		if (states.idleFrames >= kSettleFrames) {
+			glfwWaitEventsTimeout(kIdleWaitSeconds);
+			states.idleFrames = 0;
+		}
+		else {
+			glfwPollEvents();
+		}
+		states.frameIndex++;
+		states.animating = false;
 
-		for (auto& state : states.states) {
-			std::string reloadError;
-			refresh_image_if_changed(state, reloadError);
+		process_scan_results(states);
+		process_decode_results(states);
+		process_preview_results(states);
+		update_sequence_playback(states, glfwGetTime());
+
+		// Only files the watcher flagged are stat'ed; everything else costs nothing per frame.
+		for (const std::string& changedPath : take_changed_files(states.watcher)) {
+			for (auto& state : states.states) {
+				if (array_file_path(state.normalizedPath) == changedPath) {
+					std::string reloadError;
+					refresh_image_if_changed(states, state, reloadError);
+				}
+			}
 		}
 
 		ImGui_ImplOpenGL3_NewFrame();
 		ImGui_ImplGlfw_NewFrame();
 		ImGui::NewFrame();
 
+		// Next/previous image, with key repeat; prefetch_neighbors keeps the neighbours decoded.
+		// On a sequence entry the arrows step frames and Space plays or pauses.
+		if (!ImGui::GetIO().WantTextInput && !states.states.empty()) {
+			ImageState& current = states.states[states.selected];
+			if (current.sequence) {
+				const int frame = current.sequence->playing ? current.sequence->current : current.sequence->requested;
+				if (ImGui::IsKeyPressed(ImGuiKey_RightArrow)) {
+					seek_sequence(current, frame + 1);
+				}
+				if (ImGui::IsKeyPressed(ImGuiKey_LeftArrow)) {
+					seek_sequence(current, frame - 1);
+				}
+				if (ImGui::IsKeyPressed(ImGuiKey_Space, false)) {
+					set_sequence_playing(current, !current.sequence->playing, glfwGetTime());
+				}
+			}
+			else if (ImGui::IsKeyPressed(ImGuiKey_RightArrow)) {
+				select_image(states, states.selected + 1);
+			}
+			else if (ImGui::IsKeyPressed(ImGuiKey_LeftArrow)) {
+				select_image(states, states.selected - 1);
+			}
+			if (ImGui::IsKeyPressed(ImGuiKey_PageDown)) {
+				select_image(states, states.selected + 1);
+			}
+			if (ImGui::IsKeyPressed(ImGuiKey_PageUp)) {
+				select_image(states, states.selected - 1);
+			}
+			if (ImGui::IsKeyPressed(ImGuiKey_Home, false)) {
+				select_image(states, 0);
+			}
+			if (ImGui::IsKeyPressed(ImGuiKey_End, false)) {
+				select_image(states, (int)states.states.size() - 1);
+			}
+		}
+
 		{ // image preview window
 			ImGuiWindowFlags preview_window_flag = 0;
 			preview_window_flag |= ImGuiWindowFlags_NoTitleBar;
@@ -122,88 +189,177 @@ int ImagePixelViewer() {
 				}
 			}
 
+			if (!states.states.empty() && states.states[states.selected].stats.valid
+				&& ImGui::CollapsingHeader("Statistics")) {
+				const ImageStats& stats = states.states[states.selected].stats;
+				static const char* kBgraNames[] = { "B", "G", "R", "A" };
+				ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 1.0f, 1.0f, 1.00f));
+				ImGui::Text("Load  I/O %.1f ms  decode %.1f ms", states.states[states.selected].loadIoMs, states.states[states.selected].loadDecodeMs);
+				for (int c = 0; c < (int)stats.channels.size(); ++c) {
+					const ChannelStats& channel = stats.channels[c];
+					char name[16];
+					if (stats.channels.size() == 1) std::snprintf(name, sizeof(name), "Gray");
+					else if (stats.channels.size() >= 3 && c < 4) std::snprintf(name, sizeof(name), "%s", kBgraNames[c]);
+					else std::snprintf(name, sizeof(name), "C%d", c);
+
+					ImGui::Text("%s  min %.6g  max %.6g", name, channel.minVal, channel.maxVal);
+					ImGui::Text("    mean %.6g  std %.6g", channel.mean, channel.stddev);
+					if (channel.nanCount > 0 || channel.infCount > 0) {
+						ImGui::Text("    NaN %llu  Inf %llu", (unsigned long long)channel.nanCount, (unsigned long long)channel.infCount);
+					}
+					float bins[kStatsHistogramBins];
+					for (int b = 0; b < kStatsHistogramBins; ++b) {
+						bins[b] = (float)channel.histogram[b];
+					}
+					ImGui::PushID(c);
+					ImGui::PlotHistogram("##hist", bins, kStatsHistogramBins, 0, nullptr, 0.0f, FLT_MAX, ImVec2(-1.0f, 40.0f));
+					ImGui::PopID();
+				}
+				ImGui::PopStyleColor();
+			}
+
 			// left column: thumbnails + list
 			ImGui::Text("Images");
+			ImGui::SameLine();
+			if (ImGui::SmallButton("Open Folder...")) {
+				if (const char* folder = tinyfd_selectFolderDialog("Open Folder", nullptr)) {
+					open_folder(states, fs::u8path(folder));
+				}
+			}
+			ImGui::SameLine();
+			static const char* kSortNames[] = { "Unsorted", "Name", "Pixels", "Bytes", "Modified" };
+			int sortIndex = (int)states.sortKey;
+			ImGui::SetNextItemWidth(90.0f);
+			if (ImGui::Combo("##sort", &sortIndex, kSortNames, IM_ARRAYSIZE(kSortNames))) {
+				states.sortKey = (ImageSortKey)sortIndex;
+				sort_images(states);
+			}
+			if (states.decoder.activeScans > 0) {
+				ImGui::SameLine();
+				ImGui::TextDisabled("Scanning... %d", (int)states.states.size());
+			}
 
-			for (int i = 0; i < (int)states.states.size(); ++i) {
-				ImGui::Separator();
-
-				ImageState& img = states.states[i];
-
-				float aspect = (img.height > 0) ? (float)img.width / (float)img.height : 1.0f;
-				ImVec2 disp(thumbWidth, thumbHeight);
-				if (aspect > 1.0f) { disp.y = thumbHeight / aspect; }
-				else { disp.x = thumbWidth * aspect; }
-
-				ImGui::PushID(i);
-				int pushed = 0;
-				if (img.texture_thumb.id) {
-					if (states.selected == i) {
-						ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.15f, 0.65f, 0.15f, 1.0f)); pushed++;
-						ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.25f, 0.75f, 0.25f, 1.0f)); pushed++;
-						ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.10f, 0.55f, 0.10f, 1.0f)); pushed++;
+			// Rows have a fixed height so the clipper can skip everything off-screen;
+			// only visible rows build widgets or touch their thumbnail texture.
+			const ImGuiStyle& listStyle = ImGui::GetStyle();
+			const float rowHeight = std::max(thumbHeight + listStyle.FramePadding.y * 2.0f, ImGui::GetTextLineHeightWithSpacing() * 3.0f)
+				+ listStyle.ItemSpacing.y * 2.0f;
+			ImGui::BeginChild("##image_list", ImVec2(0.0f, 0.0f), ImGuiChildFlags_None);
+			if (states.scrollToSelected) {
+				const float selectedTop = (float)states.selected * rowHeight;
+				if (selectedTop < ImGui::GetScrollY()) {
+					ImGui::SetScrollY(selectedTop);
+				}
+				else if (selectedTop + rowHeight > ImGui::GetScrollY() + ImGui::GetWindowHeight()) {
+					ImGui::SetScrollY(selectedTop + rowHeight - ImGui::GetWindowHeight());
+				}
+				states.scrollToSelected = false;
+			}
+			ImGuiListClipper clipper;
+			clipper.Begin((int)states.states.size(), rowHeight);
+			while (clipper.Step()) {
+				for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+					if (i >= (int)states.states.size()) {
+						break; // an entry was deleted earlier this frame
 					}
-					if (ImGui::ImageButton("thumb", (void*)(intptr_t)img.texture_thumb.id, disp, ImVec2(0, 0), ImVec2(1, 1))) {
-						states.selected = i;
+					ImageState& img = states.states[i];
+					const float rowTop = ImGui::GetCursorPosY();
+					ImGui::Separator();
+
+					float aspect = (img.height > 0) ? (float)img.width / (float)img.height : 1.0f;
+					ImVec2 disp(thumbWidth, thumbHeight);
+					if (aspect > 1.0f) { disp.y = thumbHeight / aspect; }
+					else { disp.x = thumbWidth * aspect; }
+
+					// Keyed by uid so popups and widget state follow the image, not its row.
+					ImGui::PushID((int)img.uid);
+					int pushed = 0;
+					// Rows of a scanned folder decode their thumbnail once they scroll into view.
+					if (img.loadStatus == LoadStatus::Unloaded && img.thumbRGBA.empty()) {
+						queue_thumbnail_decode(states, img);
 					}
-					if (ImGui::BeginPopupContextItem(("thumb_ctx##" + std::to_string(i)).c_str(),
-						ImGuiPopupFlags_MouseButtonRight)) {
-						if (ImGui::MenuItem("Delete")) {
-							// release GL resources first
-							release_texture(states.states[i].texture);
-							release_texture(states.states[i].texture_thumb);
-
-							// fix selected index after erase
-							int oldSelected = states.selected;
-							states.states.erase(states.states.begin() + i);
-
-							if (states.states.empty()) {
-								states.selected = 0;
-							}
-							else {
-								if (oldSelected == i) {
-									// if we deleted the selected one, select the previous item (or 0)
-									states.selected = std::min(i, (int)states.states.size() - 1);
-								}
-								else if (oldSelected > i) {
-									// shift selection left since indices moved
-									states.selected = oldSelected - 1;
+					if (ensure_thumbnail_texture(states.thumbs, img, states.frameIndex)) {
+						if (states.selected == i) {
+							ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.15f, 0.65f, 0.15f, 1.0f)); pushed++;
+							ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.25f, 0.75f, 0.25f, 1.0f)); pushed++;
+							ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.10f, 0.55f, 0.10f, 1.0f)); pushed++;
+						}
+						ImVec2 uv0, uv1;
+						const ImTextureID thumbTex = thumb_slot_texture(states.thumbs, img.thumbSlot, uv0, uv1);
+						if (ImGui::ImageButton("thumb", thumbTex, disp, uv0, uv1)) {
+							states.selected = i;
+						}
+						if (ImGui::BeginPopupContextItem("thumb_ctx", ImGuiPopupFlags_MouseButtonRight)) {
+							if (!img.sequence && ImGui::MenuItem("Play as Sequence")) {
+								std::string sequenceError;
+								if (open_sequence(img, sequenceError)) {
+									states.selected = i;
 								}
 								else {
-									states.selected = oldSelected;
+									showError(sequenceError.c_str());
 								}
 							}
-
-							ImGui::CloseCurrentPopup();
-							// Important: early return from UI branch to avoid using stale 'img' reference this frame
+							if (img.sequence && !img.sequence->video && !img.sequence->pages && ImGui::MenuItem("Close Sequence")) {
+								img.sequence.reset();
+							}
+							if (ImGui::MenuItem("Delete")) {
+								remove_image_at(states, i);
+
+								ImGui::CloseCurrentPopup();
+								// Important: early return from UI branch to avoid using stale 'img' reference this frame
+								ImGui::EndPopup();
+								if (pushed > 0) ImGui::PopStyleColor(pushed);
+								ImGui::PopID();
+								// Skip the rest of the per-item UI after deletion
+								continue;
+							}
 							ImGui::EndPopup();
-							if (pushed > 0) ImGui::PopStyleColor(pushed);
-							ImGui::PopID();
-							// Skip the rest of the per-item UI after deletion
-							continue;
 						}
-						ImGui::EndPopup();
 					}
-				}
-				else {
-					ImGui::Button("NoTex", disp);
-				}
-				if (pushed > 0) ImGui::PopStyleColor(pushed);
-				ImGui::SameLine();
-				ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 1.0f, 1.0f, 1.00f));
-				ImGui::BeginGroup();
-				ImGui::TextWrapped("%s", img.filename.c_str());
-				ImGui::Text("%d x %d", img.width, img.height);
-				ImGui::Text("%d x %s", img.channels, img.depth.c_str());
-				ImGui::PopStyleColor();
+					else if (img.loadStatus != LoadStatus::Ready && !img.thumbnailFailed) {
+						// Pending decode: animate the label so a stalled queue is distinguishable from a busy one.
+						const int dots = (int)(ImGui::GetTime() * 3.0) % 4;
+						states.animating = true;
+						char pendingLabel[32];
+						std::snprintf(pendingLabel, sizeof(pendingLabel), "%s%.*s###pending",
+							(img.loadStatus == LoadStatus::Decoding) ? "Decoding" : "Queued", dots, "...");
+						ImGui::Button(pendingLabel, disp);
+					}
+					else {
+						ImGui::Button("NoTex", disp);
+					}
+					if (pushed > 0) ImGui::PopStyleColor(pushed);
+					ImGui::SameLine();
+					ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 1.0f, 1.0f, 1.00f));
+					ImGui::BeginGroup();
+					// One line only: wrapping would make row heights vary.
+					ImGui::TextUnformatted(img.filename.c_str());
+					if (img.width > 0) {
+						ImGui::Text("%d x %d", img.width, img.height);
+						if (img.sequence && img.sequence->pages) {
+							ImGui::Text("%d x %s   page %d/%d", img.channels, img.depth.c_str(), img.sequence->current + 1, img.sequence->frameCount);
+						}
+						else {
+							ImGui::Text("%d x %s", img.channels, img.depth.c_str());
+						}
+					}
+					else {
+						ImGui::TextUnformatted("Loading...");
+					}
+					ImGui::PopStyleColor();
 
-				ImGui::EndGroup();
-				ImGui::PopID();
-				ImGui::Spacing();
+					ImGui::EndGroup();
+					ImGui::PopID();
+					// Pin the row to exactly rowHeight, as the clipper assumes.
+					ImGui::SetCursorPosY(rowTop);
+					ImGui::Dummy(ImVec2(1.0f, rowHeight - listStyle.ItemSpacing.y));
+				}
 			}
+			clipper.End();
 			if (states.states.empty()) {
-				ImGui::TextDisabled("Drop & Drop images");
+				ImGui::TextDisabled("Drop images or folders");
 			}
+			ImGui::EndChild();
 
 
 			ImGui::End();
@@ -232,6 +388,7 @@ int ImagePixelViewer() {
 			ImGui::Begin("Canvas", nullptr, view_window_flag);
 
 			ImVec2 avail = ImGui::GetContentRegionAvail();
+			states.canvasSize = cv::Size((int)avail.x, (int)avail.y);
 			ImVec2 origin = ImGui::GetCursorScreenPos(); // top-left of drawable area in screen space
 
 			std::optional<std::pair<int, int>> hoveredPixel;
@@ -242,7 +399,8 @@ int ImagePixelViewer() {
 			if (states.states.size() > 0) {
 				auto& state = states.states[states.selected];
 
-				if (state.texture.id != 0 && !state.previewRGBA.empty()) {
+				if (!state.previewRGBA.empty()) {
+					state.viewed = true;
 					// Right-click anywhere in this window to open the menu
 					if (ImGui::BeginPopupContextWindow("canvas_ctx",
 						ImGuiPopupFlags_MouseButtonRight /* open on RMB */
@@ -261,15 +419,24 @@ int ImagePixelViewer() {
 						if (ImGui::MenuItem("Auto Maximize Contrast", nullptr, &states.Auto_Maximize_Contrast));
 						if (ImGui::MenuItem("1-Channel Pseudo Color", nullptr, &states.One_Channel_Pseudo_Color));
 						if (ImGui::MenuItem("4-Channel Ignore Alpha", nullptr, &states.Four_Channel_Ignore_Alpha));
+						if (ImGui::MenuItem("Zoom Out Keeps Extremes", nullptr, &states.Pyramid_Keep_Extremes));
+						if (ImGui::MenuItem("Show Pixel Values", nullptr, &states.Show_Pixel_Values));
 						ImGui::Separator();
 						if (ImGui::MenuItem("Copy Pixel Position"));
+						ImGui::Separator();
+						ImGui::SetNextItemWidth(140.0f);
+						ImGui::SliderInt("GPU Budget (MB)", &states.tiles.budgetMB, 64, 8192);
+						ImGui::SetNextItemWidth(140.0f);
+						ImGui::SliderInt("Prefetch Neighbours", &states.prefetchRadius, 0, 16);
+						ImGui::SetNextItemWidth(140.0f);
+						ImGui::SliderInt("Prefetch Budget (MB)", &states.prefetchBudgetMB, 128, 16384);
 						ImGui::EndPopup();
 					}
 					// Compute visual zoom and image size
 					float renderedZoom = state.zoom;
-					if (state.fitToWindow && state.texture.width > 0 && state.texture.height > 0 && avail.x > 0.0f && avail.y > 0.0f) {
-						float sx = avail.x / (float)state.texture.width;
-						float sy = avail.y / (float)state.texture.height;
+					if (state.fitToWindow && avail.x > 0.0f && avail.y > 0.0f) {
+						float sx = avail.x / (float)state.width;
+						float sy = avail.y / (float)state.height;
 						renderedZoom = std::max(state.minZoom, std::min(sx, sy));
 					}
 					renderedZoom = std::clamp(renderedZoom, state.minZoom, maxZoom);
@@ -279,8 +446,13 @@ int ImagePixelViewer() {
 						state.minZoom = renderedZoom;
 					}
 					ImVec2 imageSize(
-						std::max(1.0f, (float)state.texture.width * renderedZoom),
-						std::max(1.0f, (float)state.texture.height * renderedZoom));
+						std::max(1.0f, (float)state.width * renderedZoom),
+						std::max(1.0f, (float)state.height * renderedZoom));
+
+					// A proxy shown larger than 1:1 no longer has enough pixels.
+					if (renderedZoom * (float)state.proxyScale > 1.0f) {
+						request_full_resolution(states, state);
+					}
 
 
 					// Where to draw the image (screen space)
@@ -293,10 +465,13 @@ int ImagePixelViewer() {
 
 					ImVec2 imageTopLeft = state.fitToWindow ? centered : ImVec2(base.x + state.pan.x, base.y + state.pan.y);
 
-					// Draw the image
-					const ImTextureID texId = (ImTextureID)(uintptr_t)state.texture.id;
+					// Draw the image: only the tiles inside the window are resident on the GPU.
+					// The Dummy item stands in for ImGui::Image so hover queries keep working.
+					if (!draw_tiled_image(ImGui::GetWindowDrawList(), states.tiles, state, imageTopLeft, imageSize, states.frameIndex)) {
+						states.animating = true; // more tiles to upload next frame
+					}
 					ImGui::SetCursorScreenPos(imageTopLeft);
-					ImGui::Image(texId, imageSize);
+					ImGui::Dummy(imageSize);
 
 					// Hover/interaction
 					ImGuiIO& io = ImGui::GetIO();
@@ -378,7 +553,28 @@ int ImagePixelViewer() {
 							hoveredPixel = std::make_pair(px, py);
 							hoveredForTooltip = imgHovered;
 
-							hoveredOriginalValue = format_pixel_value(state.sourceOriginal, px, py);
+							if (state.sizeLimited) {
+								// The exact value under the cursor comes from a full-resolution tile read.
+								const int fx = (int)std::clamp(std::floor(u * (float)state.width), 0.0f, (float)(state.width - 1));
+								const int fy = (int)std::clamp(std::floor(v * (float)state.height), 0.0f, (float)(state.height - 1));
+								if (!state.exactTile.empty() && state.exactTileRect.contains(cv::Point(fx, fy))) {
+									hoveredOriginalValue = format_pixel_value(state.exactTile, fx - state.exactTileRect.x, fy - state.exactTileRect.y);
+								}
+								else if (request_exact_tile(states, state, fx, fy)) {
+									hoveredOriginalValue = "Reading full-resolution pixel...";
+								}
+								else {
+									hoveredOriginalValue = "Reduced 1/" + std::to_string(state.proxyScale) + ": full resolution exceeds the decode limit";
+								}
+							}
+							else if (state.proxyScale > 1) {
+								// Proxy values are resampled; only the full decode gives an exact readout.
+								request_full_resolution(states, state);
+								hoveredOriginalValue = "Loading full resolution...";
+							}
+							else {
+								hoveredOriginalValue = format_pixel_value(state.sourceOriginal, px, py);
+							}
 
 							if (!ImGui::IsMouseDragging(ImGuiMouseButton_Left) && !ImGui::IsMouseDragging(ImGuiMouseButton_Middle))
 								ImGui::SetMouseCursor(ImGuiMouseCursor_Hand);
@@ -386,36 +582,22 @@ int ImagePixelViewer() {
 					}
 
 					// Grid (only when pixels are large enough)
-					if ((pixelWidth >= 4.0f || pixelHeight >= 4.0f) && state.previewRGBA.cols > 0 && state.previewRGBA.rows > 0) {
-						ImDrawList* drawList = ImGui::GetWindowDrawList();
-						const ImU32 gridColor = IM_COL32(255, 255, 255, 40);
-						for (int cx = 1; cx < state.previewRGBA.cols; ++cx) {
-							float xPos = itemMin.x + (float)cx * pixelWidth;
-							if (xPos > itemMax.x) break;
-							drawList->AddLine(ImVec2(xPos, itemMin.y), ImVec2(xPos, itemMax.y), gridColor, 1.0f);
-						}
-						for (int cy = 1; cy < state.previewRGBA.rows; ++cy) {
-							float yPos = itemMin.y + (float)cy * pixelHeight;
-							if (yPos > itemMax.y) break;
-							drawList->AddLine(ImVec2(itemMin.x, yPos), ImVec2(itemMax.x, yPos), gridColor, 1.0f);
-						}
+					if (pixelWidth >= 4.0f || pixelHeight >= 4.0f) {
+						draw_pixel_grid(ImGui::GetWindowDrawList(), itemMin, itemMax, state.previewRGBA.cols, state.previewRGBA.rows,
+							pixelWidth, pixelHeight, IM_COL32(255, 255, 255, 40));
+					}
+					// Original values printed inside each visible cell once the cells are big enough.
+					// A proxy's cells are resampled, so none are printed until the full decode lands
+					// (zooming in far enough to show them already asks for it).
+					if (states.Show_Pixel_Values && state.proxyScale == 1) {
+						draw_pixel_values(ImGui::GetWindowDrawList(), itemMin, itemMax, state.sourceOriginal, state.previewRGBA,
+							pixelWidth, pixelHeight);
 					}
 
 					// Crosshair for hovered pixel
 					if (hoveredPixel) {
-						int px = hoveredPixel->first;
-						int py = hoveredPixel->second;
-
-						ImDrawList* dl = ImGui::GetWindowDrawList();
-						const ImU32 overlay = IM_COL32(255, 255, 0, 200);
-
-						ImVec2 pxTL(itemMin.x + px * pixelWidth, itemMin.y + py * pixelHeight);
-						ImVec2 pxBR(pxTL.x + pixelWidth, pxTL.y + pixelHeight);
-						ImVec2 pxC(pxTL.x + pixelWidth * 0.5f, pxTL.y + pixelHeight * 0.5f);
-
-						dl->AddRect(pxTL, pxBR, overlay, 0.0f, 0, 1.0f);
-						dl->AddLine(ImVec2(pxC.x, itemMin.y), ImVec2(pxC.x, itemMax.y), overlay, 1.0f);
-						dl->AddLine(ImVec2(itemMin.x, pxC.y), ImVec2(itemMax.x, pxC.y), overlay, 1.0f);
+						draw_pixel_crosshair(ImGui::GetWindowDrawList(), itemMin, itemMax, hoveredPixel->first, hoveredPixel->second,
+							pixelWidth, pixelHeight, IM_COL32(255, 255, 0, 200));
 					}
 					if (hoveredForTooltip) {
 						std::string tooltip = hoveredOriginalValue;
@@ -460,6 +642,18 @@ int ImagePixelViewer() {
 							}
 						}
 					}
+
+					draw_sequence_hud(state, origin, avail, glfwGetTime());
+				}
+				else if (state.loadStatus != LoadStatus::Ready) {
+					// A prefetch still waiting in the queue is overtaken by an urgent decode.
+					const bool prefetchWaiting = state.loadStatus == LoadStatus::Queued && states.prefetchDecodes.count(state.uid) != 0;
+					if (state.loadStatus == LoadStatus::Unloaded || prefetchWaiting) {
+						states.prefetchDecodes.erase(state.uid);
+						queue_image_decode(states, state, false, false, true);
+					}
+					ImGui::Dummy(ImVec2(0.0f, 120.0f));
+					ImGui::TextUnformatted("Loading...");
 				}
 				else {
 					ImGui::Dummy(ImVec2(0.0f, 120.0f));
@@ -479,15 +673,20 @@ int ImagePixelViewer() {
 		if (states.Gray_Image != states.Gray_Image_Last
 			|| states.Auto_Maximize_Contrast != states.Auto_Maximize_Contrast_Last
 			|| states.One_Channel_Pseudo_Color != states.One_Channel_Pseudo_Color_Last
-			|| states.Four_Channel_Ignore_Alpha != states.Four_Channel_Ignore_Alpha_Last) {
-			for (auto& state : states.states) {
-				std::string updateError;
-				rebuild_preview_from_source(state, states.Gray_Image, states.Auto_Maximize_Contrast, states.One_Channel_Pseudo_Color, states.Four_Channel_Ignore_Alpha, updateError);
-			}
+			|| states.Four_Channel_Ignore_Alpha != states.Four_Channel_Ignore_Alpha_Last
+			|| states.Pyramid_Keep_Extremes != states.Pyramid_Keep_Extremes_Last) {
+			cancel_stale_previews(states);
 			states.Gray_Image_Last = states.Gray_Image;
 			states.Auto_Maximize_Contrast_Last = states.Auto_Maximize_Contrast;
 			states.One_Channel_Pseudo_Color_Last = states.One_Channel_Pseudo_Color;
 			states.Four_Channel_Ignore_Alpha_Last = states.Four_Channel_Ignore_Alpha;
+			states.Pyramid_Keep_Extremes_Last = states.Pyramid_Keep_Extremes;
+		}
+		draw_raw_import_dialog(states);
+		prefetch_neighbors(states);
+		schedule_preview_rebuilds(states);
+		if (states.frameIndex % 60 == 0) {
+			evict_unused_thumbnails(states);
 		}
 
 		ImGui::Render();
@@ -499,10 +698,23 @@ int ImagePixelViewer() {
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
 		glfwSwapBuffers(window);
+
+		// Text fields blink their cursor; everything else redraws only when something happened.
+		if (states.animating || ImGui::GetIO().WantTextInput) {
+			states.idleFrames = 0;
+		}
+		else {
+			states.idleFrames++;
+		}
 	}
 
-	for (auto& state : states.states)
-		release_texture(state.texture);
+	stop_file_watcher(states.watcher);
+	stop_worker_pool(states.decoder.pool);
+	states.states.clear(); // joins video decoder threads while GLFW is still up
+
+	release_tile_cache(states.tiles);
+	release_thumbnail_atlas(states.thumbs);
+	release_upload_ring();
 
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
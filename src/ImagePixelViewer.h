@@ -31,12 +31,55 @@
 #include <array>
 #include <unordered_set>
 #include <limits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <atomic>
+#include <unordered_map>
+#include <chrono>
+#include <list>
+#include <memory>
 
 #pragma region Consts
 const float PREVIEW_WIDTH = 300.0f;
 const float maxZoom = 72.0f;
 const float thumbWidth = 96.0f;
 const float thumbHeight = 54.0f;
+const int kStatsHistogramBins = 256;
+const int kTileSize = 1024;
+const int kDefaultTileBudgetMB = 512;
+// The pyramid stops halving once the longer side fits in this many pixels.
+const int kPyramidMinSide = 256;
+// Frames drawn after the last event before the loop goes back to sleep; ImGui needs a
+// couple to settle hover and layout changes.
+const int kSettleFrames = 3;
+// Thumbnail textures not drawn for this many frames are released; the CPU copy stays.
+const int kThumbEvictFrames = 300;
+const int kThumbAtlasPageSize = 2048;
+// Decodes whose header says they would allocate more than this are refused, or taken
+// at reduced resolution where the format allows it.
+const std::uint64_t kMaxDecodeBytes = 4ull << 30;
+// Full-resolution window read around the cursor when only a proxy of a TIFF fits.
+const int kExactTileSize = 256;
+// Files per header-probe job during a folder scan.
+const int kScanBatchSize = 256;
+// Images kept decoded on either side of the selection, and the CPU memory they may use.
+const int kDefaultPrefetchRadius = 3;
+const int kDefaultPrefetchBudgetMB = 1024;
+// Sequence playback: frames decoded ahead of the play head, and the default rate.
+const int kSequenceRingFrames = 8;
+const float kDefaultSequenceFps = 24.0f;
+// Page stacks: decoded pages kept per entry, the least recently shown going first.
+const int kPageCacheFrames = 6;
+// Video: decoded frames kept around the play head (fewer for large frames), the hand-off
+// queue from the decoder thread, and how far forward reading beats a keyframe seek.
+const int kVideoCacheFrames = 32;
+const int kVideoQueueFrames = 4;
+const int kVideoSeekThreshold = 60;
+// Upper bound on an idle sleep, so a missed wake-up cannot freeze the window for long.
+const double kIdleWaitSeconds = 2.0;
 static const std::unordered_set<std::string> kExt{
 	// bitmap
 	".bmp", ".dib",
@@ -54,11 +97,29 @@ static const std::unordered_set<std::string> kExt{
 	".sr", ".ras",
 	// webp (if built with webp)
 	".webp",
+	// gif (OpenCV 4.11+)
+	".gif",
 	// hdr-ish
 	".hdr", ".pic",
 	// OpenEXR (if built with OpenEXR)
 	".exr"
 };
+// Containers opened with cv::VideoCapture as a frame stack.
+static const std::unordered_set<std::string> kVideoExt{
+	".mp4", ".m4v", ".mov", ".avi", ".mkv", ".webm"
+};
+// Formats that can hold several pages or animation frames.
+static const std::unordered_set<std::string> kPagedExt{
+	".tif", ".tiff", ".gif", ".webp"
+};
+// Headerless sensor dumps; their layout comes from a RawFormat saved next to them.
+static const std::unordered_set<std::string> kRawExt{
+	".raw", ".bin"
+};
+// NumPy arrays; an .npz lists one entry per member.
+static const std::unordered_set<std::string> kArrayExt{
+	".npy", ".npz"
+};
 #define _S(_LITERAL)    (const char*)u8##_LITERAL
 #pragma endregion
 
@@ -82,16 +143,162 @@ struct ImageTexture {
 	GLuint id = 0;
 	int width = 0;
 	int height = 0;
+	GLint internalFormat = 0;
+};
+
+enum class LoadStatus {
+	Ready,
+	Queued,
+	Decoding,
+	// Metadata and thumbnail came from the disk cache; pixels are decoded when first shown.
+	Unloaded,
+};
+
+struct PreviewOptions {
+	bool gray = false;
+	bool autoContrast = false;
+	bool pseudoColor = false;
+	bool ignoreAlpha = false;
+	bool pyramidKeepExtremes = false;
+};
+
+inline bool operator==(const PreviewOptions& a, const PreviewOptions& b) {
+	return a.gray == b.gray && a.autoContrast == b.autoContrast
+		&& a.pseudoColor == b.pseudoColor && a.ignoreAlpha == b.ignoreAlpha
+		&& a.pyramidKeepExtremes == b.pyramidKeepExtremes;
+}
+inline bool operator!=(const PreviewOptions& a, const PreviewOptions& b) { return !(a == b); }
+
+struct ChannelStats {
+	double minVal = 0.0;
+	double maxVal = 0.0;
+	double mean = 0.0;
+	double stddev = 0.0;
+	std::uint64_t finiteCount = 0;
+	std::uint64_t nanCount = 0;
+	std::uint64_t infCount = 0;
+	// Bins span [minVal, maxVal] of the finite values.
+	std::array<std::uint32_t, kStatsHistogramBins> histogram{};
+};
+
+// Statistics of sourceOriginal, computed once at decode time.
+struct ImageStats {
+	bool valid = false;
+	std::vector<ChannelStats> channels;
+};
+
+// CPU side of a preview build; produced off the GL thread, uploaded on it.
+struct PreviewImages {
+	cv::Mat previewRGBA;
+	// previewRGBA halved repeatedly; pyramid[0] is the half-size level.
+	std::vector<cv::Mat> pyramid;
+	cv::Mat thumbRGBA;
+	double minVal = 0.0;
+	double maxVal = 0.0;
+	bool hasMinMax = false;
+};
+
+// Reduced-resolution first decode chosen by plan_proxy_decode.
+struct ProxyPlan {
+	int flags = 0;
+	int scale = 1;
+	int fullWidth = 0;
+	int fullHeight = 0;
+};
+
+// What the on-disk thumbnail cache stores per file.
+struct ThumbnailCacheEntry {
+	std::int32_t width = 0;
+	std::int32_t height = 0;
+	std::int32_t channels = 0;
+	std::string depth;
+	cv::Mat thumbRGBA;
+};
+
+struct MappedFile;
+void unmap_file(MappedFile& file);
+
+// How a mapping will be read. Sequential asks the OS to read the whole file ahead, for a
+// codec that consumes all of it; Random leaves paging on demand, for pixels used in place
+// or read a window at a time.
+enum class MapAccess {
+	Sequential,
+	Random,
+};
+
+// Read-only mapping of a whole file, released on destruction.
+struct MappedFile {
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#else
+	int fd = -1;
+#endif
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile() { unmap_file(*this); }
+};
+
+// Layout of a headerless raw file. Rows start `stride` bytes apart (0 = tightly packed)
+// after `offset` header bytes.
+struct RawFormat {
+	int width = 0;
+	int height = 0;
+	int channels = 1;
+	int depth = CV_16U;
+	bool bigEndian = false;
+	std::int64_t stride = 0;
+	std::int64_t offset = 0;
 };
 
+// One array of an .npy/.npz file as the viewer shows it: `frames` images of
+// width x height x channels. (H,W), (H,W,C) and (N,H,W[,C]) shapes are accepted.
+struct ArrayInfo {
+	std::string member; // .npz member name without ".npy"; empty for a plain .npy
+	int width = 0;
+	int height = 0;
+	int channels = 1;
+	int depth = -1;
+	int frames = 1;
+};
+
+// Lets a background job notice that the request it serves has been superseded.
+struct CancelToken {
+	const std::atomic<std::uint64_t>* generation = nullptr;
+	std::uint64_t expected = 0;
+	bool requested() const {
+		return generation != nullptr && generation->load(std::memory_order_relaxed) != expected;
+	}
+};
+
+struct SequencePlayer;
+
 struct ImageState {
+	std::uint64_t uid = 0;
+	std::uint64_t decodeSerial = 0;
+	std::uint64_t previewSerial = 0;
+	LoadStatus loadStatus = LoadStatus::Ready;
+	// Set once the image has been shown in the canvas; unviewed images defer preview rebuilds.
+	bool viewed = false;
+	bool previewPending = false;
+	PreviewOptions pendingOptions;
 	std::array<char, 512> inputBuffer{};
-	ImageTexture texture{};
-	ImageTexture texture_thumb{};
+	// Slot in ImageStates::thumbs, -1 when not resident. Uploaded lazily when the list row
+	// is visible; the slot holds thumbVersion.
+	int thumbSlot = -1;
+	cv::Mat thumbRGBA;
+	std::uint64_t thumbVersion = 0;
+	bool thumbnailFailed = false;
+	std::uint64_t thumbLastUsedFrame = 0;
 	cv::Mat sourceOriginal;
-	cv::Mat preview8u;
 	cv::Mat previewRGBA;
+	std::vector<cv::Mat> previewPyramid;
+	std::uint64_t previewVersion = 0;
 	std::string currentPath;
+	std::string normalizedPath;
 	std::string filename;
 	std::string depth;
 	fs::file_time_type lastWriteTime{};
@@ -101,18 +308,282 @@ struct ImageState {
 	bool pseudoColorApplied = false;
 	bool ignoreAlphaApplied = false;
 	bool grayApplied = false;
+	bool pyramidKeepExtremesApplied = false;
 	bool fitToWindow = true;
-	int width;
-	int height;
-	int channels;
+	int width = 0;
+	int height = 0;
+	int channels = 0;
 	double minVal = 0.0;
 	double maxVal = 0.0;
 	bool hasMinMax = false;
+	ImageStats stats;
+	// sourceOriginal is 1/proxyScale of the file's resolution until the full decode lands;
+	// width/height and all view geometry are always in full-resolution pixels.
+	int proxyScale = 1;
+	bool fullResPending = false;
+	// The proxy is all there will be: full resolution exceeds kMaxDecodeBytes.
+	bool sizeLimited = false;
+	// For a size-limited TIFF, the full-resolution pixels of exactTileRect, read on hover so
+	// the canvas still shows exact values. Failed means the file cannot be read that way.
+	cv::Mat exactTile;
+	cv::Rect exactTileRect;
+	bool exactTilePending = false;
+	bool exactTileFailed = false;
+	// Milliseconds the last decode spent getting the file into memory and in the codec.
+	double loadIoMs = 0.0;
+	double loadDecodeMs = 0.0;
+	// Set when this entry plays a numbered file set or pages through a multi-page file;
+	// currentPath is then the frame on screen.
+	std::shared_ptr<SequencePlayer> sequence;
 	float minZoom = -1;
 	float zoom = 1.0f;
 	ImVec2 pan = ImVec2(0.0f, 0.0f);
 };
 
+struct WorkerPool {
+	std::vector<std::thread> threads;
+	std::deque<std::function<void()>> jobs;
+	std::deque<std::function<void()>> urgentJobs;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping = false;
+};
+
+// Result of a background decode, matched back to its ImageState by uid.
+// A result with `started` set is only a progress notification.
+struct DecodeResult {
+	std::uint64_t uid = 0;
+	std::uint64_t serial = 0;
+	bool started = false;
+	bool reload = false;
+	bool ok = false;
+	std::string error;
+	PreviewOptions options;
+	cv::Mat source;
+	ImageStats stats;
+	PreviewImages preview;
+	int proxyScale = 1;
+	bool sizeLimited = false;
+	int fullWidth = 0;
+	int fullHeight = 0;
+	double ioMs = 0.0;
+	double decodeMs = 0.0;
+	fs::file_time_type writeTime{};
+	std::uintmax_t fileSize = 0;
+	bool hasFileStamp = false;
+	// Lazy list decode: only the thumbnail and metadata are kept, the pixels are dropped.
+	bool thumbnailOnly = false;
+	bool prefetch = false;
+	// Set by the caller when the decode is a list entry's own file, the only key the folder
+	// scan reads back; ring fills, pages and array frames leave the thumbnail cache alone.
+	bool cacheThumbnail = false;
+	// Ring fill for a sequence player; serial is the slot's, not the entry's decodeSerial.
+	int sequenceFrame = -1;
+	int pageCount = 0; // pages in a multi-page file, counted when its first page is decoded
+	// Set for a full-resolution window read by request_exact_tile; source holds just that.
+	cv::Rect region;
+};
+
+// Result of a background preview rebuild triggered by a display toggle.
+struct PreviewResult {
+	std::uint64_t uid = 0;
+	std::uint64_t serial = 0;
+	std::uint64_t decodeSerial = 0;
+	bool ok = false;
+	bool cancelled = false;
+	PreviewOptions options;
+	PreviewImages preview;
+	std::string error;
+};
+
+// One decoded frame of a sequence, waiting in the ring until the play head reaches it.
+struct SequenceSlot {
+	int frame = -1;
+	std::uint64_t serial = 0;
+	bool ready = false;
+	std::uint64_t lastShown = 0; // SequencePlayer::shown when last on screen
+	DecodeResult result;
+};
+
+struct VideoDecoder;
+void stop_video_decoder(VideoDecoder& video);
+
+// Reads a video on its own thread, in order, into a bounded queue. Seeking goes through
+// CAP_PROP_POS_FRAMES, which restarts decoding at the preceding keyframe, so the player
+// only seeks when reading forward would not get there as cheaply.
+struct VideoDecoder {
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping = false;
+	std::string path;
+	// Filled in by the decoder thread once the file is open.
+	bool opened = false;
+	std::string error;
+	int frameCount = 0;
+	int width = 0;
+	int height = 0;
+	double fps = 0.0;
+	// Next frame the stream delivers (moved by a seek) and where the player wants it to stop.
+	int position = 0;
+	int wantEnd = 0;
+	std::uint64_t generation = 0;
+	PreviewOptions options;
+	std::deque<DecodeResult> frames;
+	~VideoDecoder() { stop_video_decoder(*this); }
+};
+
+// A numbered file set (frame_000001.png ...) or a video played through a single list entry,
+// so zoom, pan and the display toggles carry over from frame to frame.
+struct SequencePlayer {
+	std::vector<std::string> frames; // paths in frame-number order; empty for a video
+	std::shared_ptr<VideoDecoder> video;
+	int frameCount = 0;
+	int current = 0;   // frame on screen
+	int requested = 0; // frame asked for by scrubbing or stepping; shown once decoded
+	bool playing = false;
+	bool loop = true;
+	float fps = kDefaultSequenceFps;
+	// Playback clock: frame `anchorFrame` was due at `anchorTime`.
+	double anchorTime = 0.0;
+	int anchorFrame = 0;
+	std::uint64_t droppedFrames = 0;
+	std::uint64_t nextSerial = 0;
+	std::uint64_t shown = 0;
+	int inFlight = 0;
+	// The frames are the pages of one multi-page file: only the neighbours of the page on
+	// screen are decoded ahead and the rest of the ring keeps recently shown pages.
+	bool pages = false;
+	std::vector<SequenceSlot> ring;
+};
+
+struct FileStamp {
+	fs::file_time_type writeTime{};
+	std::uintmax_t fileSize = 0;
+	bool valid = false;
+};
+
+enum class ImageSortKey {
+	None, // arrival order
+	Name,
+	Pixels,
+	Bytes,
+	Modified,
+};
+
+enum class ImageFormat {
+	Unknown,
+	Jpeg,
+	Png,
+	Tiff,
+	Bmp,
+	Pnm,
+	Exr,
+	WebP,
+};
+
+// Dimensions read from a file header without decoding. channels/depth describe what
+// cv::imread(IMREAD_UNCHANGED) will return; depth is -1 when unknown.
+struct ImageHeader {
+	ImageFormat format = ImageFormat::Unknown;
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	int depth = -1;
+	int components = 0; // as stored in the file (JPEG: 1, 3 or 4)
+};
+
+// One file found by a folder scan, probed on a worker before it reaches the list.
+struct ScannedFile {
+	std::string path;
+	std::string normalizedPath;
+	FileStamp stamp;
+	bool cached = false;
+	ThumbnailCacheEntry cache;
+	bool probed = false;
+	ImageHeader header;
+};
+
+struct DecodePipeline {
+	WorkerPool pool;
+	std::mutex resultMutex;
+	std::vector<DecodeResult> results;
+	std::vector<PreviewResult> previewResults;
+	std::vector<ScannedFile> scanResults;
+	std::atomic<int> activeScans{ 0 };
+	// Bumped whenever the display toggles change; in-flight rebuilds for older values give up.
+	std::atomic<std::uint64_t> previewGeneration{ 0 };
+};
+
+// Reports changes to loaded files: inotify on the parent directories on Linux,
+// stat polling on a background thread elsewhere and for network mounts.
+struct FileWatcher {
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping = false;
+	std::unordered_set<std::string> watchedPaths;
+	std::unordered_set<std::string> changedPaths;
+	std::unordered_map<std::string, FileStamp> polledPaths;
+	// Files that need polling but have not been decoded yet; see activate_watch.
+	std::unordered_map<std::string, FileStamp> dormantPaths;
+#ifdef __linux__
+	struct DirWatch {
+		int wd = -1;
+		int refCount = 0;
+	};
+	int inotifyFd = -1;
+	int wakePipe[2] = { -1, -1 };
+	std::unordered_map<int, std::string> dirByWatch;
+	std::unordered_map<std::string, DirWatch> watchByDir;
+	// Directories on network filesystems, which inotify cannot watch; checked once each.
+	std::unordered_set<std::string> remoteDirs;
+#endif
+};
+
+struct TileKey {
+	std::uint64_t uid = 0;
+	int level = 0;
+	int tx = 0;
+	int ty = 0;
+	bool operator==(const TileKey& other) const {
+		return uid == other.uid && level == other.level && tx == other.tx && ty == other.ty;
+	}
+};
+
+struct TileKeyHash {
+	size_t operator()(const TileKey& key) const {
+		return std::hash<std::uint64_t>()((key.uid * 0x9E3779B97F4A7C15ull + (std::uint64_t)key.level) ^ ((std::uint64_t)key.ty << 32) ^ (std::uint32_t)key.tx);
+	}
+};
+
+struct TextureTile {
+	ImageTexture texture;
+	std::uint64_t version = 0;
+	std::uint64_t lastUsedFrame = 0;
+	size_t bytes = 0;
+	std::list<TileKey>::iterator lruPos;
+};
+
+// Canvas textures: fixed-size tiles of previewRGBA, uploaded when they become visible
+// and evicted least-recently-drawn first once the GPU budget is reached.
+struct TileCache {
+	std::unordered_map<TileKey, TextureTile, TileKeyHash> tiles;
+	std::list<TileKey> lru; // front = most recently drawn
+	size_t residentBytes = 0;
+	int budgetMB = kDefaultTileBudgetMB;
+	int tileSize = kTileSize;
+};
+
+// Thumbnails share a few large textures, one fixed thumbWidth x thumbHeight slot each,
+// so the list binds a handful of textures instead of one per image.
+struct ThumbnailAtlas {
+	std::vector<ImageTexture> pages;
+	std::vector<int> freeSlots;
+	int nextSlot = 0;
+	int pageSize = kThumbAtlasPageSize;
+};
+
 struct ImageStates {
 	bool Link_View = false;
 	bool Gray_Image = false;
@@ -123,8 +594,37 @@ struct ImageStates {
 	bool One_Channel_Pseudo_Color_Last = false;
 	bool Four_Channel_Ignore_Alpha = false;
 	bool Four_Channel_Ignore_Alpha_Last = false;
+	bool Pyramid_Keep_Extremes = false;
+	bool Pyramid_Keep_Extremes_Last = false;
+	bool Show_Pixel_Values = true;
 	vector<ImageState> states;
 	int selected = 0;
+	std::uint64_t nextUid = 1;
+	DecodePipeline decoder;
+	FileWatcher watcher;
+	TileCache tiles;
+	ThumbnailAtlas thumbs;
+	std::uint64_t frameIndex = 0;
+	// Canvas size in pixels, the target for reduced first decodes.
+	cv::Size canvasSize;
+	// normalizedPath of every entry, so large folder scans dedupe in O(1).
+	std::unordered_set<std::string> knownPaths;
+	ImageSortKey sortKey = ImageSortKey::None;
+	// uids with a thumbnail-only decode in flight; bounded so fast scrolling cannot flood the pool.
+	std::unordered_set<std::uint64_t> thumbnailDecodes;
+	// Neighbours of the selection decoded ahead of time; see prefetch_neighbors.
+	int prefetchRadius = kDefaultPrefetchRadius;
+	int prefetchBudgetMB = kDefaultPrefetchBudgetMB;
+	std::unordered_set<std::uint64_t> prefetchDecodes;
+	// Dropped raw files waiting for their layout in the Raw Import dialog.
+	std::vector<std::string> pendingRawPaths;
+	RawFormat rawDraft;
+	bool rawDraftSidecar = false;
+	// Set by keyboard navigation so the list scrolls the new selection into view.
+	bool scrollToSelected = false;
+	// Set during a frame by anything that needs the next frame drawn without an event.
+	bool animating = false;
+	int idleFrames = 0;
 };
 #pragma endregion
 
@@ -135,13 +635,161 @@ struct ImageStates {
 #pragma region Utils
 
 void glfw_error_callback(int error, const char* description);
+void request_redraw();
 void drop_callback(GLFWwindow* window, int count, const char** paths);
 void release_texture(ImageTexture& texture);
-bool load_image_from_path(ImageState& state, std::string& errorOut, bool showErrors = true);
-bool refresh_image_if_changed(ImageState& state, std::string& errorOut);
-bool rebuild_preview_from_source(ImageState& state, bool grayImage, bool autoMaximizeContrast, bool oneChannelPseudoColor, bool ignoreAlpha, std::string& errorOut);
+bool refresh_image_if_changed(ImageStates& states, ImageState& state, std::string& errorOut);
+bool read_file_stamp(const std::string& path, fs::file_time_type& outWriteTime, std::uintmax_t& outFileSize, std::string& errorOut);
+std::string normalize_path(const fs::path& path);
+bool is_opencv_supported_ext(const std::string& extLower);
+std::string to_lower(std::string s);
 std::string format_pixel_value(const cv::Mat& mat, int x, int y);
+std::vector<ChannelLabel> make_channel_labels(const cv::Mat& mat);
+int make_channel_labels(int channels, std::array<ChannelLabel, 4>& labels);
 void DeleteSelected(ImageStates& states);
+void remove_image_at(ImageStates& states, int index);
+void showError(const char* message);
+PreviewOptions preview_options_of(const ImageState& state);
+PreviewOptions desired_preview_options(const ImageStates& states);
+bool build_preview_images(const cv::Mat& source, const ImageStats& stats, const PreviewOptions& options, PreviewImages& out, std::string& errorOut, const CancelToken& cancel = {});
+bool render_preview_rgba(const cv::Mat& source, const ImageStats& stats, const PreviewOptions& options, PreviewImages& out, std::string& errorOut, const CancelToken& cancel = {});
+bool build_preview_pyramid(const cv::Mat& rgba, bool keepExtremes, std::vector<cv::Mat>& levels, const CancelToken& cancel = {});
+int pyramid_level_for_zoom(const ImageState& state, float zoom);
+bool apply_preview_images(ImageState& state, PreviewImages& images, const PreviewOptions& options, std::string& errorOut);
+bool ensure_thumbnail_texture(ThumbnailAtlas& atlas, ImageState& state, std::uint64_t frame);
+void evict_unused_thumbnails(ImageStates& states);
+void compute_image_stats(const cv::Mat& source, ImageStats& stats);
+bool decode_image_file(const std::string& path, const PreviewOptions& options, DecodeResult& result, cv::Size proxyTarget = cv::Size());
+bool probe_image_header(const std::string& path, ImageHeader& header, int page = 0);
+int count_image_pages(const std::string& path);
+std::string entry_file_path(const std::string& path);
+std::uint64_t estimated_decode_bytes(const ImageHeader& header);
+const char* depth_to_string(int depth);
+bool plan_proxy_decode(const ImageHeader& header, cv::Size target, std::uint64_t maxBytes, ProxyPlan& plan);
+bool apply_decoded_image(ImageState& state, DecodeResult& result, std::string& errorOut);
+#pragma endregion
+
+#pragma region Textures
+bool allocate_texture(ImageTexture& texture, int width, int height, GLint internalFormat, GLenum dataType, std::string& error);
+bool create_texture_from_rgba(ImageTexture& texture, const cv::Mat& rgbaImage, std::string& error);
+bool texture_format_for(int matType, GLint& internalFormat, GLenum& dataType);
+bool upload_texture_pixels(const ImageTexture& texture, const cv::Mat& rgba, int dstX, int dstY, std::string& error);
+void release_upload_ring();
+bool draw_tiled_image(ImDrawList* drawList, TileCache& cache, const ImageState& state, ImVec2 topLeft, ImVec2 size, std::uint64_t frame);
+void release_image_tiles(TileCache& cache, std::uint64_t uid);
+void release_tile_cache(TileCache& cache);
+bool acquire_thumb_slot(ThumbnailAtlas& atlas, int& slot, std::string& error);
+void release_thumb_slot(ThumbnailAtlas& atlas, int& slot);
+bool upload_thumb_slot(ThumbnailAtlas& atlas, int slot, const cv::Mat& rgba, std::string& error);
+ImTextureID thumb_slot_texture(const ThumbnailAtlas& atlas, int slot, ImVec2& uv0, ImVec2& uv1);
+void release_thumbnail_atlas(ThumbnailAtlas& atlas);
+#pragma endregion
+
+#pragma region Canvas
+void draw_pixel_grid(ImDrawList* drawList, ImVec2 itemMin, ImVec2 itemMax, int cols, int rows, float pixelWidth, float pixelHeight, ImU32 color);
+void draw_pixel_values(ImDrawList* drawList, ImVec2 itemMin, ImVec2 itemMax, const cv::Mat& source, const cv::Mat& preview,
+	float pixelWidth, float pixelHeight);
+void draw_pixel_crosshair(ImDrawList* drawList, ImVec2 itemMin, ImVec2 itemMax, int px, int py, float pixelWidth, float pixelHeight, ImU32 color);
+#pragma endregion
+
+#pragma region FolderScan
+ImageState& add_image_entry(ImageStates& states, const fs::path& path, const std::string& normalizedPath, const FileStamp* scannedStamp = nullptr);
+void open_folder(ImageStates& states, const fs::path& folder);
+void process_scan_results(ImageStates& states);
+void sort_images(ImageStates& states);
+#pragma endregion
+
+#pragma region Prefetch
+void select_image(ImageStates& states, int index);
+void prefetch_neighbors(ImageStates& states);
+void unload_image(ImageStates& states, ImageState& state);
+std::uint64_t estimated_image_bytes(const ImageState& state);
+#pragma endregion
+
+#pragma region Sequence
+bool find_sequence_frames(const fs::path& path, std::vector<std::string>& frames, int& index);
+bool open_sequence(ImageState& state, std::string& errorOut);
+void seek_sequence(ImageState& state, int frame);
+void set_sequence_playing(ImageState& state, bool playing, double now);
+void store_sequence_frame(ImageState& state, DecodeResult& result);
+void update_sequence_playback(ImageStates& states, double now);
+void release_sequence_frames(SequencePlayer& player);
+void draw_sequence_hud(ImageState& state, ImVec2 origin, ImVec2 avail, double now);
+#pragma endregion
+
+#pragma region MappedFile
+bool map_file(const std::string& path, MappedFile& file, std::string& errorOut, MapAccess access = MapAccess::Sequential);
+bool read_image_mapped(const std::string& path, ImageFormat format, int flags, cv::Mat& out, double& ioMs, double& decodeMs);
+cv::Mat wrap_mapped_pixels(std::unique_ptr<MappedFile> file, const unsigned char* pixels, int rows, int cols, int type, size_t step);
+#pragma endregion
+
+#pragma region Raw
+bool is_raw_ext(const std::string& extLower);
+bool read_raw_format(const std::string& path, RawFormat& format, std::string& errorOut);
+bool write_raw_format(const std::string& path, const RawFormat& format, bool sidecar, std::string& errorOut);
+bool map_raw_image(const std::string& path, const RawFormat& format, cv::Mat& out, std::string& errorOut);
+void draw_raw_import_dialog(ImageStates& states);
+#pragma endregion
+
+#pragma region Array
+bool is_array_ext(const std::string& extLower);
+std::string array_file_path(const std::string& path);
+bool list_array_members(const std::string& path, std::vector<ArrayInfo>& members, std::string& errorOut);
+bool read_array_image(const std::string& path, cv::Mat& out, std::string& errorOut);
+bool find_array_frames(const std::string& path, std::vector<std::string>& frames, int& index);
+int count_array_file_entries(const ImageStates& states, const std::string& normalizedFile);
+void open_array_file(ImageStates& states, const fs::path& path);
+#pragma endregion
+
+#pragma region Pages
+bool is_paged_ext(const std::string& extLower);
+std::string page_file_path(const std::string& path);
+int page_of_path(const std::string& path);
+bool read_image_page(const std::string& path, int page, cv::Mat& out, std::string& errorOut);
+void open_page_stack(ImageState& state, int pageCount, const DecodeResult* firstPage);
+#pragma endregion
+
+#pragma region Tiff
+void init_tiff_reader();
+bool read_tiff_image(const std::string& path, int page, int scale, cv::Mat& out, double& ioMs, double& decodeMs, std::string& errorOut);
+bool read_tiff_region(const std::string& path, int page, cv::Rect region, cv::Mat& out, std::string& errorOut);
+#pragma endregion
+
+#pragma region Video
+bool is_video_ext(const std::string& extLower);
+void open_video(ImageState& state);
+#pragma endregion
+
+#pragma region ThumbnailCache
+bool read_thumbnail_cache(const std::string& normalizedPath, fs::file_time_type writeTime, std::uintmax_t fileSize, const PreviewOptions& options, ThumbnailCacheEntry& entry);
+void write_thumbnail_cache(const std::string& normalizedPath, fs::file_time_type writeTime, std::uintmax_t fileSize, const PreviewOptions& options, const ThumbnailCacheEntry& entry);
+void prune_thumbnail_cache();
+#pragma endregion
+
+#pragma region Workers
+void start_worker_pool(WorkerPool& pool, int threadCount);
+void submit_job(WorkerPool& pool, std::function<void()> job, bool urgent = false);
+void stop_worker_pool(WorkerPool& pool);
+int default_worker_count();
+void queue_image_decode(ImageStates& states, ImageState& state, bool reload = false, bool fullResolution = false, bool urgent = false);
+void queue_prefetch_decode(ImageStates& states, ImageState& state);
+void request_full_resolution(ImageStates& states, ImageState& state);
+bool request_exact_tile(ImageStates& states, ImageState& state, int x, int y);
+void queue_thumbnail_decode(ImageStates& states, ImageState& state);
+bool worker_pool_stopping(WorkerPool& pool);
+void process_decode_results(ImageStates& states);
+void cancel_stale_previews(ImageStates& states);
+void schedule_preview_rebuilds(ImageStates& states);
+void process_preview_results(ImageStates& states);
+#pragma endregion
+
+#pragma region FileWatcher
+void start_file_watcher(FileWatcher& watcher);
+void stop_file_watcher(FileWatcher& watcher);
+void watch_file(FileWatcher& watcher, const std::string& path, const FileStamp* known = nullptr, bool dormant = false);
+void activate_watch(FileWatcher& watcher, const std::string& path);
+void unwatch_file(FileWatcher& watcher, const std::string& path);
+std::vector<std::string> take_changed_files(FileWatcher& watcher);
 #pragma endregion
 
 
@@ -0,0 +1,187 @@
+#include "ImagePixelViewer.h"
+
+// Visible part of the image item, in screen space. Empty when the image is scrolled out.
+static bool visible_item_rect(ImDrawList* drawList, ImVec2 itemMin, ImVec2 itemMax, ImVec2& outMin, ImVec2& outMax) {
+	const ImVec2 clipMin = drawList->GetClipRectMin();
+	const ImVec2 clipMax = drawList->GetClipRectMax();
+	outMin = ImVec2(std::max(itemMin.x, clipMin.x), std::max(itemMin.y, clipMin.y));
+	outMax = ImVec2(std::min(itemMax.x, clipMax.x), std::min(itemMax.y, clipMax.y));
+	return outMin.x < outMax.x && outMin.y < outMax.y;
+}
+
+// Pixel grid limited to the lines that cross the visible rect, so its cost follows the
+// window size rather than the image size. All lines go out as one primitive reservation.
+void draw_pixel_grid(ImDrawList* drawList, ImVec2 itemMin, ImVec2 itemMax, int cols, int rows, float pixelWidth, float pixelHeight, ImU32 color) {
+	ImVec2 visMin, visMax;
+	if (cols <= 0 || rows <= 0 || pixelWidth <= 0.0f || pixelHeight <= 0.0f
+		|| !visible_item_rect(drawList, itemMin, itemMax, visMin, visMax)) {
+		return;
+	}
+	const int cx0 = std::max(1, (int)std::ceil((visMin.x - itemMin.x) / pixelWidth));
+	const int cx1 = std::min(cols - 1, (int)std::floor((visMax.x - itemMin.x) / pixelWidth));
+	const int cy0 = std::max(1, (int)std::ceil((visMin.y - itemMin.y) / pixelHeight));
+	const int cy1 = std::min(rows - 1, (int)std::floor((visMax.y - itemMin.y) / pixelHeight));
+	const int lines = std::max(0, cx1 - cx0 + 1) + std::max(0, cy1 - cy0 + 1);
+	if (lines == 0) {
+		return;
+	}
+
+	drawList->PrimReserve(lines * 6, lines * 4);
+	for (int cx = cx0; cx <= cx1; ++cx) {
+		const float x = std::floor(itemMin.x + (float)cx * pixelWidth);
+		drawList->PrimRect(ImVec2(x, visMin.y), ImVec2(x + 1.0f, visMax.y), color);
+	}
+	for (int cy = cy0; cy <= cy1; ++cy) {
+		const float y = std::floor(itemMin.y + (float)cy * pixelHeight);
+		drawList->PrimRect(ImVec2(visMin.x, y), ImVec2(visMax.x, y + 1.0f), color);
+	}
+}
+
+// Outline of the hovered pixel plus full-height/width lines through its centre.
+void draw_pixel_crosshair(ImDrawList* drawList, ImVec2 itemMin, ImVec2 itemMax, int px, int py, float pixelWidth, float pixelHeight, ImU32 color) {
+	ImVec2 visMin, visMax;
+	if (!visible_item_rect(drawList, itemMin, itemMax, visMin, visMax)) {
+		return;
+	}
+	const ImVec2 pxTL(itemMin.x + px * pixelWidth, itemMin.y + py * pixelHeight);
+	const ImVec2 pxBR(pxTL.x + pixelWidth, pxTL.y + pixelHeight);
+	const ImVec2 pxC(pxTL.x + pixelWidth * 0.5f, pxTL.y + pixelHeight * 0.5f);
+
+	drawList->AddRect(pxTL, pxBR, color, 0.0f, 0, 1.0f);
+	drawList->AddLine(ImVec2(pxC.x, visMin.y), ImVec2(pxC.x, visMax.y), color, 1.0f);
+	drawList->AddLine(ImVec2(visMin.x, pxC.y), ImVec2(visMax.x, pxC.y), color, 1.0f);
+}
+
+template <typename T>
+static int format_component(char* buffer, size_t size, T value) {
+	if constexpr (std::is_floating_point<T>::value) {
+		return std::snprintf(buffer, size, "%.4g", (double)value);
+	}
+	else {
+		return std::snprintf(buffer, size, "%d", (int)value);
+	}
+}
+
+// 0..1 brightness of the displayed pixel, used to pick a readable text colour.
+static float preview_luma(const cv::Mat& rgba, int x, int y) {
+	switch (rgba.depth()) {
+	case CV_8U: {
+		const uchar* p = rgba.ptr<uchar>(y) + x * 4;
+		return (0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2]) / 255.0f;
+	}
+	case CV_16U: {
+		const ushort* p = rgba.ptr<ushort>(y) + x * 4;
+		return (0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2]) / 65535.0f;
+	}
+	case CV_32F: {
+		const float* p = rgba.ptr<float>(y) + x * 4;
+		return 0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2];
+	}
+	default:
+		return 0.0f;
+	}
+}
+
+// Widest text one component of this depth formats to, which sets the smallest cell that
+// can hold the values without spilling into its neighbours.
+static const char* widest_component(int depth) {
+	switch (depth) {
+	case CV_8U: return "255";
+	case CV_8S: return "-128";
+	case CV_16U: return "65535";
+	case CV_16S: return "-32768";
+	case CV_32S: return "-2147483648";
+	case CV_32F: return "-8.888e+38";
+	default: return "-8.888e+308";
+	}
+}
+
+// Label prefix of a line; a single line needs none.
+static int format_channel_label(char* buffer, size_t size, const ChannelLabel& label, int lines) {
+	if (lines < 2) {
+		return 0;
+	}
+	const int length = label.name != nullptr ? std::snprintf(buffer, size, "%s ", label.name) : std::snprintf(buffer, size, "C%d ", label.index);
+	return std::clamp(length, 0, (int)size - 1);
+}
+
+// One centred line per channel in every visible cell, in the tooltip's order and with its
+// labels (R, G, B, A rather than storage order). Text is formatted into a stack buffer, so
+// the per-frame cost is the glyph quads and nothing else.
+template <typename T>
+static void draw_cell_values(ImDrawList* drawList, ImVec2 itemMin, const cv::Mat& source, const cv::Mat& preview,
+	const std::array<ChannelLabel, 4>& labels, int lines, int x0, int x1, int y0, int y1, float pixelWidth, float pixelHeight, float lineHeight) {
+	const int channels = source.channels();
+	const float blockHeight = lineHeight * (float)lines;
+	const bool samePreviewSize = preview.cols == source.cols && preview.rows == source.rows;
+	char buffer[32];
+	for (int y = y0; y <= y1; ++y) {
+		const T* row = source.ptr<T>(y);
+		const float top = itemMin.y + y * pixelHeight + (pixelHeight - blockHeight) * 0.5f;
+		for (int x = x0; x <= x1; ++x) {
+			const T* px = row + (size_t)x * channels;
+			const float luma = samePreviewSize ? preview_luma(preview, x, y) : 0.0f;
+			const ImU32 color = luma > 0.5f ? IM_COL32(0, 0, 0, 220) : IM_COL32(255, 255, 255, 220);
+			const float cellLeft = itemMin.x + x * pixelWidth;
+			for (int line = 0; line < lines; ++line) {
+				const int c = std::clamp(labels[line].index, 0, channels - 1);
+				const int prefix = format_channel_label(buffer, sizeof(buffer), labels[line], lines);
+				const int length = prefix + std::clamp(format_component<T>(buffer + prefix, sizeof(buffer) - prefix, px[c]), 0, (int)sizeof(buffer) - 1 - prefix);
+				const float width = ImGui::CalcTextSize(buffer, buffer + length).x;
+				drawList->AddText(ImVec2(cellLeft + (pixelWidth - width) * 0.5f, top + line * lineHeight), color, buffer, buffer + length);
+			}
+		}
+	}
+}
+
+// Does nothing until a cell can hold one line per channel.
+void draw_pixel_values(ImDrawList* drawList, ImVec2 itemMin, ImVec2 itemMax, const cv::Mat& source, const cv::Mat& preview,
+	float pixelWidth, float pixelHeight) {
+	if (source.empty()) {
+		return;
+	}
+	std::array<ChannelLabel, 4> labels;
+	const int lines = make_channel_labels(source.channels(), labels);
+	char widest[32];
+	const int prefix = format_channel_label(widest, sizeof(widest), ChannelLabel{ 9, nullptr }, lines);
+	std::snprintf(widest + prefix, sizeof(widest) - prefix, "%s", widest_component(source.depth()));
+	const float lineHeight = ImGui::GetFontSize();
+	const float minCellWidth = ImGui::CalcTextSize(widest).x + 4.0f;
+	if (pixelHeight < lineHeight * (float)lines + 2.0f || pixelWidth < minCellWidth) {
+		return;
+	}
+	ImVec2 visMin, visMax;
+	if (!visible_item_rect(drawList, itemMin, itemMax, visMin, visMax)) {
+		return;
+	}
+	const int x0 = std::max(0, (int)std::floor((visMin.x - itemMin.x) / pixelWidth));
+	const int x1 = std::min(source.cols - 1, (int)std::floor((visMax.x - itemMin.x) / pixelWidth));
+	const int y0 = std::max(0, (int)std::floor((visMin.y - itemMin.y) / pixelHeight));
+	const int y1 = std::min(source.rows - 1, (int)std::floor((visMax.y - itemMin.y) / pixelHeight));
+
+	switch (source.depth()) {
+	case CV_8U:
+		draw_cell_values<unsigned char>(drawList, itemMin, source, preview, labels, lines, x0, x1, y0, y1, pixelWidth, pixelHeight, lineHeight);
+		break;
+	case CV_8S:
+		draw_cell_values<signed char>(drawList, itemMin, source, preview, labels, lines, x0, x1, y0, y1, pixelWidth, pixelHeight, lineHeight);
+		break;
+	case CV_16U:
+		draw_cell_values<uint16_t>(drawList, itemMin, source, preview, labels, lines, x0, x1, y0, y1, pixelWidth, pixelHeight, lineHeight);
+		break;
+	case CV_16S:
+		draw_cell_values<int16_t>(drawList, itemMin, source, preview, labels, lines, x0, x1, y0, y1, pixelWidth, pixelHeight, lineHeight);
+		break;
+	case CV_32S:
+		draw_cell_values<int32_t>(drawList, itemMin, source, preview, labels, lines, x0, x1, y0, y1, pixelWidth, pixelHeight, lineHeight);
+		break;
+	case CV_32F:
+		draw_cell_values<float>(drawList, itemMin, source, preview, labels, lines, x0, x1, y0, y1, pixelWidth, pixelHeight, lineHeight);
+		break;
+	case CV_64F:
+		draw_cell_values<double>(drawList, itemMin, source, preview, labels, lines, x0, x1, y0, y1, pixelWidth, pixelHeight, lineHeight);
+		break;
+	default:
+		return;
+	}
+}
@@ -0,0 +1,51 @@
+#include "ImagePixelViewer.h"
+
+// Decode strategy: JPEGs larger than the canvas are first decoded with libjpeg's DCT
+// scaling (IMREAD_REDUCED_*), which skips most of the IDCT work. The full-resolution
+// decode follows only when the view needs it.
+// TIFFs have no cheap reduced decode: every strip is inflated either way, so they get a
+// point-sampled proxy from read_tiff_image only when the full image would not fit.
+
+// Picks the largest DCT scale (1/2, 1/4, 1/8) that still covers `target` when the full
+// image is fitted into it, and at least the scale that brings the decode under
+// `maxBytes`. TIFFs take any power of two up to 32, for the size limit only.
+// Returns false when a full decode is the better choice.
+bool plan_proxy_decode(const ImageHeader& header, cv::Size target, std::uint64_t maxBytes, ProxyPlan& plan) {
+	const bool tiff = header.format == ImageFormat::Tiff;
+	if ((header.format != ImageFormat::Jpeg && !tiff) || header.width <= 0 || header.height <= 0) {
+		return false;
+	}
+	const int scaleLimit = tiff ? 32 : 8;
+	int scale = 1;
+	if (!tiff && target.width > 0 && target.height > 0) {
+		// Fitted display size is full * fit, so the proxy needs full / scale >= full * fit.
+		const double maxScale = std::max((double)header.width / target.width, (double)header.height / target.height);
+		while (scale < 8 && scale * 2 <= maxScale) {
+			scale *= 2;
+		}
+	}
+	while (scale < scaleLimit && maxBytes > 0 && estimated_decode_bytes(header) / ((std::uint64_t)scale * scale) > maxBytes) {
+		scale *= 2;
+	}
+	if (scale == 1) {
+		return false;
+	}
+	plan.scale = scale;
+	plan.fullWidth = header.width;
+	plan.fullHeight = header.height;
+	if (tiff) {
+		plan.flags = cv::IMREAD_UNCHANGED;
+		return true;
+	}
+
+	const bool gray = header.components == 1;
+	int flags = 0;
+	switch (scale) {
+	case 2: flags = gray ? cv::IMREAD_REDUCED_GRAYSCALE_2 : cv::IMREAD_REDUCED_COLOR_2; break;
+	case 4: flags = gray ? cv::IMREAD_REDUCED_GRAYSCALE_4 : cv::IMREAD_REDUCED_COLOR_4; break;
+	default: flags = gray ? cv::IMREAD_REDUCED_GRAYSCALE_8 : cv::IMREAD_REDUCED_COLOR_8; break;
+	}
+	// IMREAD_UNCHANGED ignores EXIF orientation, so the proxy must too or the two would not line up.
+	plan.flags = flags | cv::IMREAD_IGNORE_ORIENTATION;
+	return true;
+}
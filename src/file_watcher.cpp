@@ -0,0 +1,311 @@
+#include "ImagePixelViewer.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/vfs.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+// Files the kernel cannot notify us about are stat'ed on the watcher thread at this interval.
+static const int kPollIntervalMs = 500;
+
+static void wake_watcher(FileWatcher& watcher) {
+#ifdef __linux__
+	if (watcher.wakePipe[1] >= 0) {
+		const char byte = 1;
+		ssize_t written = write(watcher.wakePipe[1], &byte, 1);
+		(void)written;
+	}
+#endif
+	watcher.wake.notify_all();
+}
+
+static void mark_changed(FileWatcher& watcher, const std::string& path) {
+	{
+		std::lock_guard<std::mutex> lock(watcher.mutex);
+		if (watcher.watchedPaths.count(path) == 0) {
+			return;
+		}
+		watcher.changedPaths.insert(path);
+	}
+	request_redraw();
+}
+
+// Stats every polled file once. Runs on the watcher thread so the GL thread never blocks on a slow mount.
+static void poll_file_stamps(FileWatcher& watcher) {
+	std::vector<std::pair<std::string, FileStamp>> snapshot;
+	{
+		std::lock_guard<std::mutex> lock(watcher.mutex);
+		snapshot.assign(watcher.polledPaths.begin(), watcher.polledPaths.end());
+	}
+
+	for (auto& entry : snapshot) {
+		FileStamp current;
+		std::string stampError;
+		current.valid = read_file_stamp(entry.first, current.writeTime, current.fileSize, stampError);
+		const FileStamp& last = entry.second;
+		const bool changed = current.valid != last.valid
+			|| (current.valid && (current.writeTime != last.writeTime || current.fileSize != last.fileSize));
+		if (!changed) {
+			continue;
+		}
+		{
+			std::lock_guard<std::mutex> lock(watcher.mutex);
+			auto it = watcher.polledPaths.find(entry.first);
+			if (it == watcher.polledPaths.end()) {
+				continue; // unwatched meanwhile
+			}
+			it->second = current;
+		}
+		if (current.valid) {
+			mark_changed(watcher, entry.first);
+		}
+	}
+}
+
+#ifdef __linux__
+// inotify does not see writes made by other hosts on network filesystems, so those are polled instead.
+static bool is_remote_filesystem(const std::string& dir) {
+	struct statfs info {};
+	if (statfs(dir.c_str(), &info) != 0) {
+		return true;
+	}
+	switch ((unsigned long)info.f_type) {
+	case 0x6969UL:     // NFS
+	case 0x517BUL:     // SMB
+	case 0xFF534D42UL: // CIFS
+	case 0xFE534D42UL: // SMB2
+	case 0x65735546UL: // FUSE (sshfs, ...)
+	case 0x01021997UL: // 9P
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void drain_inotify(FileWatcher& watcher) {
+	alignas(struct inotify_event) char buffer[16 * 1024];
+	for (;;) {
+		const ssize_t length = read(watcher.inotifyFd, buffer, sizeof(buffer));
+		if (length <= 0) {
+			return;
+		}
+		for (ssize_t offset = 0; offset < length;) {
+			const auto* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+			offset += (ssize_t)sizeof(struct inotify_event) + event->len;
+			if (event->len == 0) {
+				continue;
+			}
+			std::string dir;
+			{
+				std::lock_guard<std::mutex> lock(watcher.mutex);
+				auto it = watcher.dirByWatch.find(event->wd);
+				if (it == watcher.dirByWatch.end()) {
+					continue;
+				}
+				dir = it->second;
+			}
+			mark_changed(watcher, (fs::path(dir) / event->name).lexically_normal().string());
+		}
+	}
+}
+#endif
+
+static void watcher_loop(FileWatcher* watcher) {
+	auto lastPoll = std::chrono::steady_clock::now();
+	for (;;) {
+		bool polling = false;
+		{
+			std::lock_guard<std::mutex> lock(watcher->mutex);
+			if (watcher->stopping) {
+				return;
+			}
+			polling = !watcher->polledPaths.empty();
+		}
+
+#ifdef __linux__
+		if (watcher->inotifyFd >= 0) {
+			struct pollfd fds[2] = {
+				{ watcher->inotifyFd, POLLIN, 0 },
+				{ watcher->wakePipe[0], POLLIN, 0 },
+			};
+			// Sleep indefinitely when every file is covered by inotify.
+			const int ready = poll(fds, 2, polling ? kPollIntervalMs : -1);
+			if (ready > 0 && (fds[1].revents & POLLIN)) {
+				char sink[64];
+				while (read(watcher->wakePipe[0], sink, sizeof(sink)) > 0) {}
+			}
+			if (ready > 0 && (fds[0].revents & POLLIN)) {
+				drain_inotify(*watcher);
+			}
+			const auto now = std::chrono::steady_clock::now();
+			if (polling && now - lastPoll >= std::chrono::milliseconds(kPollIntervalMs)) {
+				lastPoll = now;
+				poll_file_stamps(*watcher);
+			}
+			continue;
+		}
+#endif
+		{
+			std::unique_lock<std::mutex> lock(watcher->mutex);
+			watcher->wake.wait_for(lock, std::chrono::milliseconds(kPollIntervalMs), [watcher] { return watcher->stopping; });
+			if (watcher->stopping) {
+				return;
+			}
+		}
+		poll_file_stamps(*watcher);
+	}
+}
+
+void start_file_watcher(FileWatcher& watcher) {
+	watcher.stopping = false;
+#ifdef __linux__
+	watcher.inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (watcher.inotifyFd >= 0 && pipe2(watcher.wakePipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+		close(watcher.inotifyFd);
+		watcher.inotifyFd = -1;
+	}
+	if (watcher.inotifyFd < 0) {
+		std::fprintf(stderr, "inotify unavailable, falling back to polling for file changes.\n");
+	}
+#endif
+	watcher.thread = std::thread(watcher_loop, &watcher);
+}
+
+void stop_file_watcher(FileWatcher& watcher) {
+	{
+		std::lock_guard<std::mutex> lock(watcher.mutex);
+		watcher.stopping = true;
+	}
+	wake_watcher(watcher);
+	if (watcher.thread.joinable()) {
+		watcher.thread.join();
+	}
+#ifdef __linux__
+	if (watcher.inotifyFd >= 0) {
+		close(watcher.inotifyFd);
+		close(watcher.wakePipe[0]);
+		close(watcher.wakePipe[1]);
+		watcher.inotifyFd = -1;
+		watcher.wakePipe[0] = watcher.wakePipe[1] = -1;
+	}
+	watcher.dirByWatch.clear();
+	watcher.watchByDir.clear();
+	watcher.remoteDirs.clear();
+#endif
+}
+
+#ifdef __linux__
+// Adds `dir` to the inotify watches, or takes another reference on its watch. False when the
+// directory has to be polled. The statfs behind the remote check runs once per directory
+// and outside the lock, since on a slow mount it is a network round trip.
+static bool watch_directory(FileWatcher& watcher, const std::string& dir) {
+	{
+		std::lock_guard<std::mutex> lock(watcher.mutex);
+		auto it = watcher.watchByDir.find(dir);
+		if (it != watcher.watchByDir.end()) {
+			it->second.refCount++;
+			return true;
+		}
+		if (watcher.remoteDirs.count(dir) != 0) {
+			return false;
+		}
+	}
+	const bool remote = is_remote_filesystem(dir);
+	std::lock_guard<std::mutex> lock(watcher.mutex);
+	if (remote) {
+		watcher.remoteDirs.insert(dir);
+		return false;
+	}
+	// Watch the directory rather than the file so atomic rename-over saves are seen too.
+	const int wd = inotify_add_watch(watcher.inotifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_ATTRIB);
+	if (wd < 0) {
+		return false;
+	}
+	FileWatcher::DirWatch& entry = watcher.watchByDir[dir];
+	if (entry.refCount == 0) {
+		entry.wd = wd;
+		watcher.dirByWatch[wd] = dir;
+	}
+	entry.refCount++;
+	return true;
+}
+#endif
+
+// `path` must be normalized (see ImageState::normalizedPath); events are matched on that string.
+// `known` is a stamp the caller already read, saving the stat. A `dormant` file that has to be
+// polled is not stat'ed until activate_watch, so a large folder on a network mount costs
+// nothing until its files are looked at.
+void watch_file(FileWatcher& watcher, const std::string& path, const FileStamp* known, bool dormant) {
+	bool usePolling = true;
+#ifdef __linux__
+	if (watcher.inotifyFd >= 0) {
+		usePolling = !watch_directory(watcher, fs::path(path).parent_path().string());
+	}
+#endif
+	{
+		std::lock_guard<std::mutex> lock(watcher.mutex);
+		watcher.watchedPaths.insert(path);
+		if (!usePolling) {
+			return;
+		}
+	}
+
+	FileStamp stamp;
+	if (known != nullptr) {
+		stamp = *known;
+	}
+	else {
+		std::string stampError;
+		stamp.valid = read_file_stamp(path, stamp.writeTime, stamp.fileSize, stampError);
+	}
+	{
+		std::lock_guard<std::mutex> lock(watcher.mutex);
+		(dormant ? watcher.dormantPaths : watcher.polledPaths)[path] = stamp;
+	}
+	if (!dormant) {
+		wake_watcher(watcher);
+	}
+}
+
+// Starts polling a dormant file, from the stamp it was registered with; a change since then
+// is reported on the next poll. Does nothing for files already watched.
+void activate_watch(FileWatcher& watcher, const std::string& path) {
+	{
+		std::lock_guard<std::mutex> lock(watcher.mutex);
+		auto it = watcher.dormantPaths.find(path);
+		if (it == watcher.dormantPaths.end()) {
+			return;
+		}
+		watcher.polledPaths[path] = it->second;
+		watcher.dormantPaths.erase(it);
+	}
+	wake_watcher(watcher);
+}
+
+void unwatch_file(FileWatcher& watcher, const std::string& path) {
+	std::lock_guard<std::mutex> lock(watcher.mutex);
+	watcher.watchedPaths.erase(path);
+	watcher.changedPaths.erase(path);
+	if (watcher.polledPaths.erase(path) != 0 || watcher.dormantPaths.erase(path) != 0) {
+		return;
+	}
+#ifdef __linux__
+	const std::string dir = fs::path(path).parent_path().string();
+	auto it = watcher.watchByDir.find(dir);
+	if (it != watcher.watchByDir.end() && --it->second.refCount <= 0) {
+		inotify_rm_watch(watcher.inotifyFd, it->second.wd);
+		watcher.dirByWatch.erase(it->second.wd);
+		watcher.watchByDir.erase(it);
+	}
+#endif
+}
+
+std::vector<std::string> take_changed_files(FileWatcher& watcher) {
+	std::lock_guard<std::mutex> lock(watcher.mutex);
+	std::vector<std::string> changed(watcher.changedPaths.begin(), watcher.changedPaths.end());
+	watcher.changedPaths.clear();
+	return changed;
+}
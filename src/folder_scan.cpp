@@ -0,0 +1,166 @@
+#include "ImagePixelViewer.h"
+
+// New list entry with the current display flags; pixels are loaded separately. A folder scan
+// passes the stamp it read, and its entries are polled for changes only once decoded.
+ImageState& add_image_entry(ImageStates& states, const fs::path& path, const std::string& normalizedPath, const FileStamp* scannedStamp) {
+	ImageState state;
+	state.uid = states.nextUid++;
+	state.grayApplied = states.Gray_Image;
+	state.autoContrastApplied = states.Auto_Maximize_Contrast;
+	state.pseudoColorApplied = states.One_Channel_Pseudo_Color;
+	state.ignoreAlphaApplied = states.Four_Channel_Ignore_Alpha;
+	state.pyramidKeepExtremesApplied = states.Pyramid_Keep_Extremes;
+	state.currentPath = path.string();
+	state.normalizedPath = normalizedPath;
+	state.filename = path.filename().u8string();
+	// The members of one .npz share the watch on the archive.
+	const std::string watchedPath = array_file_path(normalizedPath);
+	if (watchedPath == normalizedPath || count_array_file_entries(states, watchedPath) == 0) {
+		watch_file(states.watcher, watchedPath, scannedStamp, scannedStamp != nullptr);
+	}
+	states.states.push_back(std::move(state));
+	states.knownPaths.insert(normalizedPath);
+	return states.states.back();
+}
+
+// Header probes plus thumbnail-cache lookups for one batch of paths; a cached thumbnail is
+// used only if it was rendered with the display options the scan started under.
+static void probe_scan_batch(DecodePipeline* decoder, std::vector<std::string> paths, const PreviewOptions& options) {
+	std::vector<ScannedFile> files;
+	files.reserve(paths.size());
+	for (auto& path : paths) {
+		ScannedFile file;
+		file.path = std::move(path);
+		file.normalizedPath = normalize_path(fs::path(file.path));
+		std::string stampError;
+		file.stamp.valid = read_file_stamp(file.path, file.stamp.writeTime, file.stamp.fileSize, stampError);
+		if (file.stamp.valid) {
+			file.cached = read_thumbnail_cache(file.normalizedPath, file.stamp.writeTime, file.stamp.fileSize, options, file.cache);
+		}
+		if (!file.cached) {
+			file.probed = probe_image_header(file.path, file.header);
+		}
+		files.push_back(std::move(file));
+	}
+	{
+		std::lock_guard<std::mutex> lock(decoder->resultMutex);
+		std::move(files.begin(), files.end(), std::back_inserter(decoder->scanResults));
+	}
+	decoder->activeScans--;
+	request_redraw();
+}
+
+// Enumerates on a worker and fans the header probes out in batches, so the list fills
+// while the walk is still running and no file is decoded until it is looked at.
+void open_folder(ImageStates& states, const fs::path& folder) {
+	DecodePipeline* decoder = &states.decoder;
+	const PreviewOptions options = desired_preview_options(states);
+	decoder->activeScans++;
+	submit_job(decoder->pool, [decoder, folder, options]() {
+		std::vector<std::string> batch;
+		auto flush = [decoder, &batch, &options]() {
+			if (batch.empty()) {
+				return;
+			}
+			decoder->activeScans++;
+			submit_job(decoder->pool, [decoder, paths = std::move(batch), options]() mutable {
+				probe_scan_batch(decoder, std::move(paths), options);
+			});
+			batch.clear();
+		};
+
+		std::error_code ec;
+		fs::recursive_directory_iterator it(folder, fs::directory_options::skip_permission_denied, ec);
+		for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+			if (worker_pool_stopping(decoder->pool)) {
+				break;
+			}
+			std::error_code entryError;
+			if (!it->is_regular_file(entryError)) {
+				continue;
+			}
+			const std::string extLower = to_lower(it->path().extension().string());
+			if (extLower.empty() || !(is_opencv_supported_ext(extLower) || extLower == ".npy")) {
+				continue;
+			}
+			batch.push_back(it->path().string());
+			if ((int)batch.size() >= kScanBatchSize) {
+				flush();
+			}
+		}
+		if (ec) {
+			std::fprintf(stderr, "Folder scan stopped at %s: %s\n", folder.string().c_str(), ec.message().c_str());
+		}
+		flush();
+		decoder->activeScans--;
+		request_redraw();
+	});
+}
+
+// Reorders the list by states.sortKey using header or cache metadata, so it works before
+// anything is decoded. The selection follows its image.
+void sort_images(ImageStates& states) {
+	if (states.sortKey == ImageSortKey::None || states.states.size() < 2) {
+		return;
+	}
+	const std::uint64_t selectedUid = states.states[states.selected].uid;
+	const ImageSortKey key = states.sortKey;
+	auto bytes_of = [](const ImageState& s) {
+		const std::uint64_t elemSize = (s.depth == "16U" || s.depth == "16S") ? 2
+			: (s.depth == "32S" || s.depth == "32F") ? 4 : (s.depth == "64F") ? 8 : 1;
+		return (std::uint64_t)s.width * s.height * std::max(1, s.channels) * elemSize;
+	};
+	std::stable_sort(states.states.begin(), states.states.end(), [key, &bytes_of](const ImageState& a, const ImageState& b) {
+		switch (key) {
+		case ImageSortKey::Pixels: return (std::uint64_t)a.width * a.height > (std::uint64_t)b.width * b.height;
+		case ImageSortKey::Bytes: return bytes_of(a) > bytes_of(b);
+		case ImageSortKey::Modified: return a.lastWriteTime > b.lastWriteTime;
+		default: return a.normalizedPath < b.normalizedPath;
+		}
+	});
+	for (int i = 0; i < (int)states.states.size(); ++i) {
+		if (states.states[i].uid == selectedUid) {
+			states.selected = i;
+			break;
+		}
+	}
+}
+
+// GL thread: turns probed files into Unloaded list entries.
+void process_scan_results(ImageStates& states) {
+	std::vector<ScannedFile> files;
+	{
+		std::lock_guard<std::mutex> lock(states.decoder.resultMutex);
+		files.swap(states.decoder.scanResults);
+	}
+	if (files.empty()) {
+		return;
+	}
+	for (auto& file : files) {
+		if (states.knownPaths.count(file.normalizedPath) != 0) {
+			continue;
+		}
+		ImageState& state = add_image_entry(states, fs::path(file.path), file.normalizedPath, &file.stamp);
+		state.loadStatus = LoadStatus::Unloaded;
+		if (file.stamp.valid) {
+			state.lastWriteTime = file.stamp.writeTime;
+			state.lastFileSize = file.stamp.fileSize;
+			state.hasFileStamp = true;
+		}
+		if (file.cached) {
+			state.width = file.cache.width;
+			state.height = file.cache.height;
+			state.channels = file.cache.channels;
+			state.depth = file.cache.depth;
+			state.thumbRGBA = file.cache.thumbRGBA;
+			state.previewVersion++;
+		}
+		else if (file.probed) {
+			state.width = file.header.width;
+			state.height = file.header.height;
+			state.channels = file.header.channels;
+			state.depth = file.header.depth >= 0 ? depth_to_string(file.header.depth) : "?";
+		}
+	}
+	sort_images(states);
+}
@@ -0,0 +1,426 @@
+#include "ImagePixelViewer.h"
+
+#include <fstream>
+
+// Header-only probes: size, channel count and the depth cv::imread(IMREAD_UNCHANGED)
+// will produce, read from the first bytes of the file. The format is sniffed from the
+// content, not the extension. Nothing here decodes pixel data.
+
+static std::uint16_t be16(const unsigned char* p) { return (std::uint16_t)((p[0] << 8) | p[1]); }
+static std::uint32_t be32(const unsigned char* p) { return ((std::uint32_t)p[0] << 24) | ((std::uint32_t)p[1] << 16) | ((std::uint32_t)p[2] << 8) | p[3]; }
+static std::uint16_t le16(const unsigned char* p) { return (std::uint16_t)(p[0] | (p[1] << 8)); }
+static std::uint32_t le32(const unsigned char* p) { return (std::uint32_t)p[0] | ((std::uint32_t)p[1] << 8) | ((std::uint32_t)p[2] << 16) | ((std::uint32_t)p[3] << 24); }
+static std::uint64_t be64(const unsigned char* p) { return ((std::uint64_t)be32(p) << 32) | be32(p + 4); }
+static std::uint64_t le64(const unsigned char* p) { return (std::uint64_t)le32(p) | ((std::uint64_t)le32(p + 4) << 32); }
+
+static bool read_at(std::istream& in, std::uint64_t offset, unsigned char* buffer, size_t size) {
+	in.clear();
+	in.seekg((std::streamoff)offset);
+	return (bool)in.read(reinterpret_cast<char*>(buffer), (std::streamsize)size);
+}
+
+// Walks the marker segments up to the first SOFn; never touches entropy-coded data.
+static bool probe_jpeg(std::istream& in, ImageHeader& header) {
+	in.clear();
+	in.seekg(2);
+	for (;;) {
+		int byte = in.get();
+		while (byte == 0xFF) {
+			byte = in.get(); // fill bytes
+		}
+		if (byte == EOF) {
+			return false;
+		}
+		const int marker = byte;
+		if (marker == 0xD8 || (marker >= 0xD0 && marker <= 0xD7) || marker == 0x01) {
+			continue; // standalone markers
+		}
+		unsigned char lengthBytes[2];
+		if (!in.read(reinterpret_cast<char*>(lengthBytes), 2)) {
+			return false;
+		}
+		const int length = be16(lengthBytes);
+		if (length < 2) {
+			return false;
+		}
+		const bool isSof = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+		if (isSof) {
+			unsigned char sof[6];
+			if (length < 8 || !in.read(reinterpret_cast<char*>(sof), 6)) {
+				return false;
+			}
+			header.height = be16(sof + 1);
+			header.width = be16(sof + 3);
+			header.components = sof[5];
+			header.channels = (sof[5] == 1) ? 1 : 3;
+			header.depth = CV_8U;
+			return true;
+		}
+		if (marker == 0xDA || marker == 0xD9) {
+			return false; // scan data before any frame header
+		}
+		in.seekg(length - 2, std::ios::cur);
+	}
+}
+
+static bool probe_png(std::istream& in, ImageHeader& header) {
+	unsigned char ihdr[25];
+	if (!read_at(in, 8, ihdr, sizeof(ihdr)) || std::memcmp(ihdr + 4, "IHDR", 4) != 0) {
+		return false;
+	}
+	header.width = (int)be32(ihdr + 8);
+	header.height = (int)be32(ihdr + 12);
+	const int bitDepth = ihdr[16];
+	const int colorType = ihdr[17];
+	header.depth = (bitDepth == 16) ? CV_16U : CV_8U;
+	switch (colorType) {
+	case 0: header.channels = 1; break; // gray
+	case 2: header.channels = 3; break; // RGB
+	case 3: header.channels = 3; break; // palette
+	case 4: header.channels = 4; break; // gray + alpha comes back as BGRA
+	case 6: header.channels = 4; break; // RGBA
+	default: return false;
+	}
+	return true;
+}
+
+// Classic TIFF and BigTIFF differ only in field widths: 4- vs 8-byte offsets and counts,
+// 12- vs 20-byte directory entries, 2- vs 8-byte entry counts.
+struct TiffFormat {
+	bool little = true;
+	bool big = false;
+	std::uint16_t u16(const unsigned char* p) const { return little ? le16(p) : be16(p); }
+	std::uint32_t u32(const unsigned char* p) const { return little ? le32(p) : be32(p); }
+	std::uint64_t u64(const unsigned char* p) const { return little ? le64(p) : be64(p); }
+	std::uint64_t offset(const unsigned char* p) const { return big ? u64(p) : u32(p); }
+	size_t entrySize() const { return big ? 20 : 12; }
+	size_t countSize() const { return big ? 8 : 2; }
+	size_t valueAt() const { return big ? 12 : 8; } // value field within an entry
+};
+
+// Byte order, flavour and first IFD offset from the file header.
+static bool read_tiff_head(std::istream& in, TiffFormat& format, std::uint64_t& firstIfd) {
+	unsigned char head[16];
+	if (!read_at(in, 0, head, 8) || !((head[0] == 'I' && head[1] == 'I') || (head[0] == 'M' && head[1] == 'M'))) {
+		return false;
+	}
+	format.little = head[0] == 'I';
+	const std::uint16_t version = format.u16(head + 2);
+	if (version == 42) {
+		format.big = false;
+		firstIfd = format.u32(head + 4);
+		return true;
+	}
+	if (version != 43 || !read_at(in, 0, head, sizeof(head)) || format.u16(head + 4) != 8) {
+		return false;
+	}
+	format.big = true;
+	firstIfd = format.u64(head + 8);
+	return true;
+}
+
+// Reads the IFD of page `page`, walking the chain up to it.
+static bool probe_tiff(std::istream& in, int page, ImageHeader& header) {
+	TiffFormat format;
+	std::uint64_t ifdOffset = 0;
+	if (!read_tiff_head(in, format, ifdOffset)) {
+		return false;
+	}
+	unsigned char countBytes[8];
+	std::unordered_set<std::uint64_t> seen; // a corrupt chain may loop
+	for (int i = 0; i < page; ++i) {
+		unsigned char next[8];
+		if (!seen.insert(ifdOffset).second || !read_at(in, ifdOffset, countBytes, format.countSize())) {
+			return false;
+		}
+		const std::uint64_t skipped = format.big ? format.u64(countBytes) : format.u16(countBytes);
+		if (!read_at(in, ifdOffset + format.countSize() + skipped * format.entrySize(), next, format.big ? 8 : 4)) {
+			return false;
+		}
+		ifdOffset = format.offset(next);
+		if (ifdOffset == 0) {
+			return false;
+		}
+	}
+	if (!read_at(in, ifdOffset, countBytes, format.countSize())) {
+		return false;
+	}
+	const std::uint64_t entries = format.big ? format.u64(countBytes) : format.u16(countBytes);
+	if (entries > 0xFFFF) {
+		return false;
+	}
+	int bitsPerSample = 1, samplesPerPixel = 1, sampleFormat = 1;
+	for (std::uint64_t i = 0; i < entries; ++i) {
+		unsigned char entry[20];
+		if (!read_at(in, ifdOffset + format.countSize() + i * format.entrySize(), entry, format.entrySize())) {
+			return false;
+		}
+		const int tag = format.u16(entry);
+		const int type = format.u16(entry + 2);
+		const std::uint64_t count = format.big ? format.u64(entry + 4) : format.u32(entry + 4);
+		// SHORT values sit in the first two bytes of the value field, LONG in the first four.
+		const unsigned char* valueField = entry + format.valueAt();
+		const std::uint64_t value = (type == 3) ? format.u16(valueField) : (type == 16) ? format.u64(valueField) : format.u32(valueField);
+		switch (tag) {
+		case 256: header.width = (int)value; break;
+		case 257: header.height = (int)value; break;
+		case 258:
+			if (count * 2 <= (format.big ? 8u : 4u)) {
+				bitsPerSample = (int)value;
+			}
+			else {
+				// One value per sample, stored out of line; they are all the same in practice.
+				unsigned char first[2];
+				if (!read_at(in, format.offset(valueField), first, 2)) {
+					return false;
+				}
+				bitsPerSample = format.u16(first);
+			}
+			break;
+		case 277: samplesPerPixel = (int)value; break;
+		case 339: sampleFormat = (int)value; break;
+		default: break;
+		}
+	}
+	// Bilevel and 4-bit data decode to 8 bit.
+	switch (bitsPerSample) {
+	case 16: header.depth = (sampleFormat == 2) ? CV_16S : CV_16U; break;
+	case 32: header.depth = (sampleFormat == 3) ? CV_32F : CV_32S; break;
+	case 64: header.depth = CV_64F; break;
+	default: header.depth = CV_8U; break;
+	}
+	header.channels = samplesPerPixel;
+	return header.width > 0 && header.height > 0;
+}
+
+static bool probe_bmp(std::istream& in, ImageHeader& header) {
+	unsigned char info[26];
+	if (!read_at(in, 14, info, sizeof(info))) {
+		return false;
+	}
+	const std::uint32_t infoSize = le32(info);
+	int bitCount = 0;
+	if (infoSize == 12) { // OS/2 BITMAPCOREHEADER
+		header.width = le16(info + 4);
+		header.height = le16(info + 6);
+		bitCount = le16(info + 10);
+	}
+	else {
+		header.width = (int)le32(info + 4);
+		header.height = std::abs((int)le32(info + 8)); // negative = top-down
+		bitCount = le16(info + 14);
+	}
+	header.channels = (bitCount == 32) ? 4 : 3;
+	header.depth = CV_8U;
+	return header.width > 0 && header.height > 0;
+}
+
+// Next whitespace-separated token of a PNM/PAM header, skipping comments.
+static bool pnm_token(std::istream& in, std::string& token) {
+	token.clear();
+	int c = in.get();
+	for (;;) {
+		while (c != EOF && std::isspace(c)) c = in.get();
+		if (c != '#') break;
+		while (c != EOF && c != '\n') c = in.get();
+	}
+	while (c != EOF && !std::isspace(c)) {
+		token.push_back((char)c);
+		c = in.get();
+	}
+	return !token.empty();
+}
+
+static bool probe_pnm(std::istream& in, ImageHeader& header) {
+	in.clear();
+	in.seekg(0);
+	std::string magic, token;
+	if (!pnm_token(in, magic) || magic.size() != 2 || magic[0] != 'P') {
+		return false;
+	}
+	int maxVal = 255;
+	if (magic[1] == '7') { // PAM: keyword/value lines up to ENDHDR
+		while (pnm_token(in, token) && token != "ENDHDR") {
+			std::string value;
+			if (!pnm_token(in, value)) return false;
+			if (token == "WIDTH") header.width = std::atoi(value.c_str());
+			else if (token == "HEIGHT") header.height = std::atoi(value.c_str());
+			else if (token == "DEPTH") header.channels = std::atoi(value.c_str());
+			else if (token == "MAXVAL") maxVal = std::atoi(value.c_str());
+		}
+	}
+	else {
+		if (!pnm_token(in, token)) return false;
+		header.width = std::atoi(token.c_str());
+		if (!pnm_token(in, token)) return false;
+		header.height = std::atoi(token.c_str());
+		const bool bilevel = magic[1] == '1' || magic[1] == '4';
+		if (!bilevel) {
+			if (!pnm_token(in, token)) return false;
+			maxVal = std::atoi(token.c_str());
+		}
+		header.channels = (magic[1] == '3' || magic[1] == '6') ? 3 : 1;
+	}
+	header.depth = (maxVal > 255) ? CV_16U : CV_8U;
+	return header.width > 0 && header.height > 0 && header.channels > 0;
+}
+
+// OpenEXR: a list of (name, type, size, value) attributes; only dataWindow and channels matter.
+static bool probe_exr(std::istream& in, ImageHeader& header) {
+	in.clear();
+	in.seekg(8);
+	auto read_cstring = [&in](std::string& out) {
+		out.clear();
+		for (int c = in.get(); c != EOF; c = in.get()) {
+			if (c == 0) return true;
+			if (out.size() > 255) return false;
+			out.push_back((char)c);
+		}
+		return false;
+	};
+	bool haveWindow = false;
+	int channels = 0;
+	std::string name, type;
+	while (read_cstring(name) && !name.empty()) {
+		unsigned char sizeBytes[4];
+		if (!read_cstring(type) || !in.read(reinterpret_cast<char*>(sizeBytes), 4)) {
+			return false;
+		}
+		const std::uint32_t size = le32(sizeBytes);
+		if (size > (1u << 24)) {
+			return false;
+		}
+		std::vector<unsigned char> value(size);
+		if (size > 0 && !in.read(reinterpret_cast<char*>(value.data()), size)) {
+			return false;
+		}
+		if (name == "dataWindow" && type == "box2i" && size == 16) {
+			header.width = (int)le32(&value[8]) - (int)le32(&value[0]) + 1;
+			header.height = (int)le32(&value[12]) - (int)le32(&value[4]) + 1;
+			haveWindow = true;
+		}
+		else if (name == "channels" && type == "chlist") {
+			// name\0 + pixelType(4) + pLinear(1) + reserved(3) + xSampling(4) + ySampling(4), then a closing \0.
+			size_t offset = 0;
+			while (offset < value.size() && value[offset] != 0) {
+				while (offset < value.size() && value[offset] != 0) offset++;
+				offset += 1 + 16;
+				channels++;
+			}
+		}
+	}
+	if (!haveWindow || channels == 0) {
+		return false;
+	}
+	// The OpenCV EXR reader returns float gray, BGR or BGRA.
+	header.channels = (channels == 1) ? 1 : (channels >= 4 ? 4 : 3);
+	header.depth = CV_32F;
+	return header.width > 0 && header.height > 0;
+}
+
+static bool probe_webp(std::istream& in, ImageHeader& header) {
+	unsigned char chunk[30];
+	if (!read_at(in, 12, chunk, sizeof(chunk))) {
+		return false;
+	}
+	header.depth = CV_8U;
+	if (std::memcmp(chunk, "VP8 ", 4) == 0) {
+		header.width = le16(chunk + 14) & 0x3FFF;
+		header.height = le16(chunk + 16) & 0x3FFF;
+		header.channels = 3;
+	}
+	else if (std::memcmp(chunk, "VP8L", 4) == 0) {
+		const std::uint32_t bits = le32(chunk + 9);
+		header.width = (int)(bits & 0x3FFF) + 1;
+		header.height = (int)((bits >> 14) & 0x3FFF) + 1;
+		header.channels = ((bits >> 28) & 1) ? 4 : 3;
+	}
+	else if (std::memcmp(chunk, "VP8X", 4) == 0) {
+		const bool alpha = (chunk[8] & 0x10) != 0;
+		header.width = (int)(chunk[12] | (chunk[13] << 8) | (chunk[14] << 16)) + 1;
+		header.height = (int)(chunk[15] | (chunk[16] << 8) | (chunk[17] << 16)) + 1;
+		header.channels = alpha ? 4 : 3;
+	}
+	else {
+		return false;
+	}
+	return header.width > 0 && header.height > 0;
+}
+
+// Fills `header` from the file's first bytes. Returns false for formats it does not know
+// (JPEG 2000, HDR, Sun raster, ...) or malformed headers; callers then fall back to decoding.
+// `page` picks a TIFF directory; the frames of other multi-page formats share one canvas.
+bool probe_image_header(const std::string& path, ImageHeader& header, int page) {
+	header = ImageHeader{};
+	std::ifstream in(fs::u8path(path), std::ios::binary);
+	unsigned char magic[12] = {};
+	if (!in || !in.read(reinterpret_cast<char*>(magic), sizeof(magic))) {
+		return false;
+	}
+
+	bool ok = false;
+	if (magic[0] == 0xFF && magic[1] == 0xD8) {
+		header.format = ImageFormat::Jpeg;
+		ok = probe_jpeg(in, header);
+	}
+	else if (std::memcmp(magic, "\x89PNG\r\n\x1a\n", 8) == 0) {
+		header.format = ImageFormat::Png;
+		ok = probe_png(in, header);
+	}
+	else if ((magic[0] == 'I' && magic[1] == 'I') || (magic[0] == 'M' && magic[1] == 'M')) {
+		header.format = ImageFormat::Tiff;
+		ok = probe_tiff(in, page, header);
+	}
+	else if (magic[0] == 'B' && magic[1] == 'M') {
+		header.format = ImageFormat::Bmp;
+		ok = probe_bmp(in, header);
+	}
+	else if (magic[0] == 'P' && magic[1] >= '1' && magic[1] <= '7') {
+		header.format = ImageFormat::Pnm;
+		ok = probe_pnm(in, header);
+	}
+	else if (le32(magic) == 20000630u) {
+		header.format = ImageFormat::Exr;
+		ok = probe_exr(in, header);
+	}
+	else if (std::memcmp(magic, "RIFF", 4) == 0 && std::memcmp(magic + 8, "WEBP", 4) == 0) {
+		header.format = ImageFormat::WebP;
+		ok = probe_webp(in, header);
+	}
+	if (!ok) {
+		header = ImageHeader{};
+	}
+	return ok;
+}
+
+// Pages in a multi-page file. TIFF and BigTIFF are counted by walking the IFD chain, which
+// reads a few bytes per page; animated GIF/WebP are left to OpenCV. Never less than 1.
+int count_image_pages(const std::string& path) {
+	std::ifstream in(fs::u8path(path), std::ios::binary);
+	TiffFormat format;
+	std::uint64_t offset = 0;
+	if (in && read_tiff_head(in, format, offset)) {
+		std::unordered_set<std::uint64_t> seen; // a corrupt chain may loop
+		int pages = 0;
+		for (; offset != 0 && seen.insert(offset).second; ++pages) {
+			unsigned char countBytes[8], next[8];
+			if (!read_at(in, offset, countBytes, format.countSize())) {
+				break;
+			}
+			const std::uint64_t entries = format.big ? format.u64(countBytes) : format.u16(countBytes);
+			if (!read_at(in, offset + format.countSize() + entries * format.entrySize(), next, format.big ? 8 : 4)) {
+				return pages + 1;
+			}
+			offset = format.offset(next);
+		}
+		return std::max(1, pages);
+	}
+	return std::max(1, (int)cv::imcount(path, cv::IMREAD_UNCHANGED));
+}
+
+// What a full IMREAD_UNCHANGED decode of this header will allocate.
+std::uint64_t estimated_decode_bytes(const ImageHeader& header) {
+	const int depth = header.depth >= 0 ? header.depth : CV_8U;
+	return (std::uint64_t)header.width * (std::uint64_t)header.height
+		* (std::uint64_t)std::max(1, header.channels) * (std::uint64_t)CV_ELEM_SIZE1(depth);
+}
@@ -0,0 +1,123 @@
+#include "ImagePixelViewer.h"
+
+// Per-strip partial sums, merged under a lock once each strip is done.
+struct StatsPartial {
+	std::vector<double> minVal;
+	std::vector<double> maxVal;
+	std::vector<double> sum;
+	std::vector<double> sumSq;
+	std::vector<std::uint64_t> finiteCount;
+	std::vector<std::uint64_t> nanCount;
+	std::vector<std::uint64_t> infCount;
+
+	explicit StatsPartial(int channels)
+		: minVal(channels, std::numeric_limits<double>::infinity()),
+		maxVal(channels, -std::numeric_limits<double>::infinity()),
+		sum(channels, 0.0), sumSq(channels, 0.0),
+		finiteCount(channels, 0), nanCount(channels, 0), infCount(channels, 0) {}
+};
+
+template <typename T>
+static void compute_stats_typed(const cv::Mat& src, ImageStats& stats) {
+	const int cn = src.channels();
+	StatsPartial total(cn);
+	std::mutex mergeMutex;
+
+	// Pass 1: range, moments and non-finite counts.
+	cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range& range) {
+		StatsPartial local(cn);
+		for (int y = range.start; y < range.end; ++y) {
+			const T* p = src.ptr<T>(y);
+			for (int x = 0; x < src.cols; ++x, p += cn) {
+				for (int c = 0; c < cn; ++c) {
+					const double v = (double)p[c];
+					if constexpr (std::is_floating_point<T>::value) {
+						if (std::isnan(v)) { local.nanCount[c]++; continue; }
+						if (std::isinf(v)) { local.infCount[c]++; continue; }
+					}
+					local.minVal[c] = std::min(local.minVal[c], v);
+					local.maxVal[c] = std::max(local.maxVal[c], v);
+					local.sum[c] += v;
+					local.sumSq[c] += v * v;
+					local.finiteCount[c]++;
+				}
+			}
+		}
+		std::lock_guard<std::mutex> lock(mergeMutex);
+		for (int c = 0; c < cn; ++c) {
+			total.minVal[c] = std::min(total.minVal[c], local.minVal[c]);
+			total.maxVal[c] = std::max(total.maxVal[c], local.maxVal[c]);
+			total.sum[c] += local.sum[c];
+			total.sumSq[c] += local.sumSq[c];
+			total.finiteCount[c] += local.finiteCount[c];
+			total.nanCount[c] += local.nanCount[c];
+			total.infCount[c] += local.infCount[c];
+		}
+	});
+
+	stats.channels.assign(cn, ChannelStats{});
+	std::vector<double> binScale(cn, 0.0);
+	for (int c = 0; c < cn; ++c) {
+		ChannelStats& channel = stats.channels[c];
+		channel.nanCount = total.nanCount[c];
+		channel.infCount = total.infCount[c];
+		channel.finiteCount = total.finiteCount[c];
+		if (total.finiteCount[c] == 0) {
+			continue;
+		}
+		const double n = (double)total.finiteCount[c];
+		channel.minVal = total.minVal[c];
+		channel.maxVal = total.maxVal[c];
+		channel.mean = total.sum[c] / n;
+		channel.stddev = std::sqrt(std::max(0.0, total.sumSq[c] / n - channel.mean * channel.mean));
+		if (channel.maxVal > channel.minVal) {
+			binScale[c] = (double)kStatsHistogramBins / (channel.maxVal - channel.minVal);
+		}
+	}
+
+	// Pass 2: histogram over each channel's own [min, max].
+	cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range& range) {
+		std::vector<std::array<std::uint32_t, kStatsHistogramBins>> local(cn);
+		for (auto& bins : local) {
+			bins.fill(0);
+		}
+		for (int y = range.start; y < range.end; ++y) {
+			const T* p = src.ptr<T>(y);
+			for (int x = 0; x < src.cols; ++x, p += cn) {
+				for (int c = 0; c < cn; ++c) {
+					const double v = (double)p[c];
+					if (!std::isfinite(v)) {
+						continue;
+					}
+					const int bin = (int)((v - stats.channels[c].minVal) * binScale[c]);
+					local[c][std::clamp(bin, 0, kStatsHistogramBins - 1)]++;
+				}
+			}
+		}
+		std::lock_guard<std::mutex> lock(mergeMutex);
+		for (int c = 0; c < cn; ++c) {
+			for (int b = 0; b < kStatsHistogramBins; ++b) {
+				stats.channels[c].histogram[b] += local[c][b];
+			}
+		}
+	});
+	stats.valid = true;
+}
+
+// Computed once per decode; preview rebuilds and the info panel reuse it until the file reloads.
+void compute_image_stats(const cv::Mat& source, ImageStats& stats) {
+	stats = ImageStats{};
+	if (source.empty()) {
+		return;
+	}
+	switch (source.depth()) {
+	case CV_8U:  compute_stats_typed<uchar>(source, stats); break;
+	case CV_8S:  compute_stats_typed<schar>(source, stats); break;
+	case CV_16U: compute_stats_typed<ushort>(source, stats); break;
+	case CV_16S: compute_stats_typed<short>(source, stats); break;
+	case CV_32S: compute_stats_typed<int>(source, stats); break;
+	case CV_32F: compute_stats_typed<float>(source, stats); break;
+	case CV_64F: compute_stats_typed<double>(source, stats); break;
+	default: break;
+	}
+}
@@ -0,0 +1,178 @@
+#include "ImagePixelViewer.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// Touched one byte per page to pull the mapping in before the codec runs.
+static const size_t kPrefaultStride = 4096;
+
+bool map_file(const std::string& path, MappedFile& file, std::string& errorOut, MapAccess access) {
+	unmap_file(file);
+#ifdef _WIN32
+	const std::wstring widePath = fs::u8path(path).wstring();
+	HANDLE handle = CreateFileW(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, access == MapAccess::Sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) {
+		errorOut = "Cannot open " + path;
+		return false;
+	}
+	file.fileHandle = handle;
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(handle, &size) || size.QuadPart <= 0) {
+		errorOut = "Cannot map empty file " + path;
+		unmap_file(file);
+		return false;
+	}
+	file.mappingHandle = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (file.mappingHandle == nullptr) {
+		errorOut = "Cannot map " + path;
+		unmap_file(file);
+		return false;
+	}
+	file.data = (const unsigned char*)MapViewOfFile(file.mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (file.data == nullptr) {
+		errorOut = "Cannot map " + path;
+		unmap_file(file);
+		return false;
+	}
+	file.size = (size_t)size.QuadPart;
+#else
+	file.fd = open(path.c_str(), O_RDONLY);
+	if (file.fd < 0) {
+		errorOut = "Cannot open " + path + ": " + std::strerror(errno);
+		return false;
+	}
+	struct stat info {};
+	if (fstat(file.fd, &info) != 0 || info.st_size <= 0) {
+		errorOut = "Cannot map empty file " + path;
+		unmap_file(file);
+		return false;
+	}
+	void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file.fd, 0);
+	if (data == MAP_FAILED) {
+		errorOut = "Cannot map " + path + ": " + std::strerror(errno);
+		unmap_file(file);
+		return false;
+	}
+	file.data = (const unsigned char*)data;
+	file.size = (size_t)info.st_size;
+	if (access == MapAccess::Sequential) {
+		// Decoders read front to back: ask for aggressive readahead and early eviction.
+		madvise(data, file.size, MADV_SEQUENTIAL);
+		madvise(data, file.size, MADV_WILLNEED);
+	}
+	else {
+		madvise(data, file.size, MADV_RANDOM);
+	}
+#endif
+	return true;
+}
+
+void unmap_file(MappedFile& file) {
+#ifdef _WIN32
+	if (file.data != nullptr) {
+		UnmapViewOfFile(file.data);
+	}
+	if (file.mappingHandle != nullptr) {
+		CloseHandle(file.mappingHandle);
+	}
+	if (file.fileHandle != nullptr) {
+		CloseHandle(file.fileHandle);
+	}
+	file.mappingHandle = nullptr;
+	file.fileHandle = nullptr;
+#else
+	if (file.data != nullptr) {
+		munmap((void*)file.data, file.size);
+	}
+	if (file.fd >= 0) {
+		close(file.fd);
+	}
+	file.fd = -1;
+#endif
+	file.data = nullptr;
+	file.size = 0;
+}
+
+// Lets a cv::Mat own a file mapping: the mapping is released with the last Mat sharing it,
+// including the copies background jobs hold.
+class MappedMatAllocator : public cv::MatAllocator {
+public:
+	cv::UMatData* allocate(int, const int*, int, void*, size_t*, cv::AccessFlag, cv::UMatUsageFlags) const override {
+		return nullptr;
+	}
+	bool allocate(cv::UMatData*, cv::AccessFlag, cv::UMatUsageFlags) const override {
+		return false;
+	}
+	void deallocate(cv::UMatData* u) const override {
+		delete static_cast<MappedFile*>(u->userdata);
+		delete u;
+	}
+};
+
+static MappedMatAllocator gMappedMatAllocator;
+
+// Wraps `rows` x `cols` pixels at `pixels`, which must lie inside `file`, without copying.
+cv::Mat wrap_mapped_pixels(std::unique_ptr<MappedFile> file, const unsigned char* pixels, int rows, int cols, int type, size_t step) {
+	cv::Mat mat(rows, cols, type, (void*)pixels, step);
+	cv::UMatData* u = new cv::UMatData(&gMappedMatAllocator);
+	u->data = u->origdata = (uchar*)file->data;
+	u->size = file->size;
+	u->refcount = 1;
+	u->userdata = file.release();
+	mat.u = u;
+	mat.allocator = &gMappedMatAllocator;
+	return mat;
+}
+
+static double elapsed_ms(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+	return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// Decodes from a read-only mapping of the file instead of imread's buffered reads into its
+// own copy. The pages are faulted in up front, so `ioMs` is the time to get the bytes into
+// memory (near zero when the page cache is hot) and `decodeMs` is the codec alone.
+// OpenEXR and formats the probe does not know go through imread: imdecode would spill
+// them to a temporary file first.
+bool read_image_mapped(const std::string& path, ImageFormat format, int flags, cv::Mat& out, double& ioMs, double& decodeMs) {
+	const auto start = std::chrono::steady_clock::now();
+	MappedFile file;
+	std::string mapError;
+	const bool fromMemory = format != ImageFormat::Exr && format != ImageFormat::Unknown;
+	if (fromMemory && map_file(path, file, mapError) && file.size <= (size_t)std::numeric_limits<int>::max()) {
+		volatile unsigned char sink = 0;
+		for (size_t offset = 0; offset < file.size; offset += kPrefaultStride) {
+			sink ^= file.data[offset];
+		}
+		(void)sink;
+		const auto mapped = std::chrono::steady_clock::now();
+
+		// Wraps the mapping without copying it.
+		const cv::Mat bytes(1, (int)file.size, CV_8U, (void*)file.data);
+		out = cv::imdecode(bytes, flags);
+		ioMs = elapsed_ms(start, mapped);
+		decodeMs = elapsed_ms(mapped, std::chrono::steady_clock::now());
+		return !out.empty();
+	}
+	if (!mapError.empty()) {
+		std::fprintf(stderr, "%s; falling back to imread\n", mapError.c_str());
+	}
+
+	out = cv::imread(path, flags);
+	ioMs = 0.0;
+	decodeMs = elapsed_ms(start, std::chrono::steady_clock::now());
+	return !out.empty();
+}
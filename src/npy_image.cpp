@@ -0,0 +1,725 @@
+#include "ImagePixelViewer.h"
+
+#include <zlib.h>
+
+// Entries inside an array file are addressed as "<file>::<member>::<frame>" for .npz and
+// "<file>::<frame>" for .npy, so each array and stack frame keeps its own list entry.
+static const char* kArraySeparator = "::";
+
+// Inflated up front for an .npz member's header; longer headers are inflated again in full.
+static const size_t kNpyHeaderProbeBytes = 4096;
+
+struct NpyHeader {
+	char kind = 0; // 'b', 'i', 'u' or 'f'
+	int itemSize = 0;
+	bool bigEndian = false;
+	bool fortranOrder = false;
+	std::vector<std::int64_t> shape;
+	size_t dataOffset = 0; // from the start of the .npy bytes
+};
+
+// Element strides, in items, of the frame, row, column and channel axes.
+struct NpyLayout {
+	ArrayInfo info;
+	std::int64_t frameStep = 0;
+	std::int64_t rowStep = 0;
+	std::int64_t colStep = 0;
+	std::int64_t channelStep = 0;
+	bool direct = false; // items are stored in `info.depth` with host byte order
+};
+
+struct ZipMember {
+	std::string name;
+	std::uint16_t method = 0;
+	std::uint64_t compressedSize = 0;
+	std::uint64_t size = 0;
+	std::uint64_t localOffset = 0;
+};
+
+static std::uint16_t le16(const unsigned char* p) { return (std::uint16_t)(p[0] | (p[1] << 8)); }
+static std::uint32_t le32(const unsigned char* p) { return (std::uint32_t)p[0] | ((std::uint32_t)p[1] << 8) | ((std::uint32_t)p[2] << 16) | ((std::uint32_t)p[3] << 24); }
+static std::uint64_t le64(const unsigned char* p) { return (std::uint64_t)le32(p) | ((std::uint64_t)le32(p + 4) << 32); }
+
+static bool host_is_big_endian() {
+	const std::uint16_t probe = 1;
+	return *reinterpret_cast<const unsigned char*>(&probe) == 0;
+}
+
+bool is_array_ext(const std::string& extLower) {
+	return kArrayExt.count(extLower) != 0;
+}
+
+static bool is_npz_file(const std::string& file) {
+	return to_lower(fs::path(file).extension().string()) == ".npz";
+}
+
+// Splits an entry path into the file on disk, the .npz member and the stack frame. Paths
+// that do not point inside an array file come back as `file` with no member and frame -1.
+static void split_array_path(const std::string& path, std::string& file, std::string& member, int& frame) {
+	file = path;
+	member.clear();
+	frame = -1;
+	for (size_t pos = path.find(kArraySeparator); pos != std::string::npos; pos = path.find(kArraySeparator, pos + 1)) {
+		if (pos < 4 || !is_array_ext(to_lower(path.substr(pos - 4, 4)))) {
+			continue;
+		}
+		file = path.substr(0, pos);
+		std::string rest = path.substr(pos + 2);
+		if (is_npz_file(file)) {
+			const size_t next = rest.find(kArraySeparator);
+			member = rest.substr(0, next);
+			rest = next == std::string::npos ? std::string() : rest.substr(next + 2);
+		}
+		if (!rest.empty()) {
+			frame = (int)std::strtol(rest.c_str(), nullptr, 10);
+		}
+		return;
+	}
+}
+
+std::string array_file_path(const std::string& path) {
+	std::string file, member;
+	int frame = -1;
+	split_array_path(path, file, member, frame);
+	return file;
+}
+
+static std::string array_entry_path(const std::string& file, const std::string& member, int frame) {
+	std::string path = file;
+	if (!member.empty()) {
+		path += kArraySeparator + member;
+	}
+	if (frame >= 0) {
+		path += kArraySeparator + std::to_string(frame);
+	}
+	return path;
+}
+
+static std::string shape_to_string(const std::vector<std::int64_t>& shape) {
+	std::ostringstream oss;
+	oss << "(";
+	for (size_t i = 0; i < shape.size(); ++i) {
+		oss << (i ? ", " : "") << shape[i];
+	}
+	oss << ")";
+	return oss.str();
+}
+
+// Reads the magic, version and Python dict literal that start every .npy file.
+static bool parse_npy_header(const unsigned char* data, size_t size, NpyHeader& header, std::string& errorOut) {
+	if (size < 10 || std::memcmp(data, "\x93NUMPY", 6) != 0) {
+		errorOut = "Not a NumPy array";
+		return false;
+	}
+	size_t prefix = 10;
+	size_t dictLength = le16(data + 8);
+	if (data[6] == 2 || data[6] == 3) {
+		if (size < 12) {
+			errorOut = "Truncated NumPy header";
+			return false;
+		}
+		prefix = 12;
+		dictLength = le32(data + 8);
+	}
+	else if (data[6] != 1) {
+		errorOut = "Unsupported NumPy format version " + std::to_string(data[6]);
+		return false;
+	}
+	if (prefix + dictLength > size) {
+		errorOut = "Truncated NumPy header";
+		return false;
+	}
+	const std::string dict((const char*)data + prefix, dictLength);
+	header = NpyHeader{};
+	header.dataOffset = prefix + dictLength;
+
+	// Position just past the ':' of `key`, with leading blanks skipped.
+	auto value_of = [&dict](const char* key) -> size_t {
+		size_t pos = dict.find(key);
+		if (pos == std::string::npos || (pos = dict.find(':', pos)) == std::string::npos) {
+			return std::string::npos;
+		}
+		pos = dict.find_first_not_of(" \t", pos + 1);
+		return pos;
+	};
+
+	const size_t descr = value_of("'descr'");
+	if (descr == std::string::npos || (dict[descr] != '\'' && dict[descr] != '"')) {
+		errorOut = "Unsupported NumPy dtype (structured arrays are not images)";
+		return false;
+	}
+	const size_t descrEnd = dict.find(dict[descr], descr + 1);
+	const std::string dtype = dict.substr(descr + 1, descrEnd == std::string::npos ? std::string::npos : descrEnd - descr - 1);
+	if (dtype.size() < 3 || std::string("<>|=").find(dtype[0]) == std::string::npos) {
+		errorOut = "Unsupported NumPy dtype " + dtype;
+		return false;
+	}
+	header.bigEndian = dtype[0] == '>' || (dtype[0] == '=' && host_is_big_endian());
+	header.kind = dtype[1];
+	header.itemSize = std::atoi(dtype.c_str() + 2);
+
+	const size_t fortran = value_of("'fortran_order'");
+	header.fortranOrder = fortran != std::string::npos && dict.compare(fortran, 4, "True") == 0;
+
+	const size_t shape = value_of("'shape'");
+	const size_t shapeEnd = shape == std::string::npos ? std::string::npos : dict.find(')', shape);
+	if (shapeEnd == std::string::npos || dict[shape] != '(') {
+		errorOut = "Missing shape in NumPy header";
+		return false;
+	}
+	const char* p = dict.c_str() + shape + 1;
+	const char* end = dict.c_str() + shapeEnd;
+	while (p < end) {
+		if (*p == ' ' || *p == ',') {
+			++p;
+			continue;
+		}
+		char* next = nullptr;
+		const long long dim = std::strtoll(p, &next, 10);
+		if (next == p || dim < 0) {
+			errorOut = "Malformed shape in NumPy header";
+			return false;
+		}
+		header.shape.push_back(dim);
+		p = next;
+		while (p < end && *p != ',') {
+			++p; // Python 2 writes long dims as "480L"
+		}
+	}
+	return true;
+}
+
+// Depth the array is shown in. 64-bit and unsigned 32-bit integers have no OpenCV depth and
+// are widened to 64F, half floats to 32F.
+static bool npy_depth(const NpyHeader& header, int& depth, bool& exact) {
+	exact = true;
+	switch (header.kind) {
+	case 'b':
+		depth = CV_8U;
+		return header.itemSize == 1;
+	case 'u':
+		depth = header.itemSize == 1 ? CV_8U : header.itemSize == 2 ? CV_16U : CV_64F;
+		exact = header.itemSize <= 2;
+		return header.itemSize == 1 || header.itemSize == 2 || header.itemSize == 4 || header.itemSize == 8;
+	case 'i':
+		depth = header.itemSize == 1 ? CV_8S : header.itemSize == 2 ? CV_16S : header.itemSize == 4 ? CV_32S : CV_64F;
+		exact = header.itemSize <= 4;
+		return header.itemSize == 1 || header.itemSize == 2 || header.itemSize == 4 || header.itemSize == 8;
+	case 'f':
+		depth = header.itemSize == 8 ? CV_64F : CV_32F;
+		exact = header.itemSize != 2;
+		return header.itemSize == 2 || header.itemSize == 4 || header.itemSize == 8;
+	default:
+		return false;
+	}
+}
+
+// Maps the array's axes onto frames, rows, columns and channels. Leading singleton axes are
+// dropped, a last axis of up to 4 is read as channels (but not 2, which no display mode
+// takes), and a longer first axis of a 3-D or 4-D array as frames.
+static bool npy_layout(const NpyHeader& header, NpyLayout& layout, std::string& errorOut) {
+	bool exact = true;
+	if (!npy_depth(header, layout.info.depth, exact)) {
+		errorOut = "Unsupported NumPy dtype " + std::string(1, header.kind) + std::to_string(header.itemSize);
+		return false;
+	}
+	layout.direct = exact && (header.itemSize == 1 || header.bigEndian == host_is_big_endian());
+
+	std::vector<std::int64_t> dims = header.shape;
+	while (dims.size() > 2 && dims.front() == 1) {
+		dims.erase(dims.begin());
+	}
+	std::vector<std::int64_t> steps(dims.size());
+	std::int64_t step = 1;
+	for (size_t i = 0; i < dims.size(); ++i) {
+		const size_t axis = header.fortranOrder ? i : dims.size() - 1 - i;
+		steps[axis] = step;
+		step *= dims[axis];
+	}
+
+	int frameAxis = -1, rowAxis = 0, colAxis = 1, channelAxis = -1;
+	if (dims.size() == 3 && dims[2] <= 4) {
+		channelAxis = 2;
+	}
+	else if (dims.size() == 3) {
+		frameAxis = 0, rowAxis = 1, colAxis = 2;
+	}
+	else if (dims.size() == 4 && dims[3] <= 4) {
+		frameAxis = 0, rowAxis = 1, colAxis = 2, channelAxis = 3;
+	}
+	else if (dims.size() != 2) {
+		errorOut = "Unsupported array shape " + shape_to_string(header.shape);
+		return false;
+	}
+	// The display modes take gray, BGR or BGRA; refuse here rather than after the decode.
+	if (channelAxis >= 0 && dims[channelAxis] == 2) {
+		errorOut = "Two-channel arrays cannot be displayed; shape " + shape_to_string(header.shape);
+		return false;
+	}
+	for (std::int64_t dim : dims) {
+		if (dim <= 0 || dim > std::numeric_limits<int>::max()) {
+			errorOut = "Unsupported array shape " + shape_to_string(header.shape);
+			return false;
+		}
+	}
+
+	layout.info.height = (int)dims[rowAxis];
+	layout.info.width = (int)dims[colAxis];
+	layout.info.channels = channelAxis >= 0 ? (int)dims[channelAxis] : 1;
+	layout.info.frames = frameAxis >= 0 ? (int)dims[frameAxis] : 1;
+	layout.rowStep = steps[rowAxis];
+	layout.colStep = steps[colAxis];
+	layout.channelStep = channelAxis >= 0 ? steps[channelAxis] : 0;
+	layout.frameStep = frameAxis >= 0 ? steps[frameAxis] : 0;
+	return true;
+}
+
+static float half_to_float(std::uint16_t half) {
+	const std::uint32_t sign = (std::uint32_t)(half & 0x8000) << 16;
+	std::uint32_t exponent = (half >> 10) & 0x1F;
+	std::uint32_t mantissa = half & 0x3FF;
+	std::uint32_t bits;
+	if (exponent == 0x1F) {
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else if (exponent != 0) {
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+	else if (mantissa == 0) {
+		bits = sign;
+	}
+	else {
+		exponent = 113;
+		while ((mantissa & 0x400) == 0) {
+			mantissa <<= 1;
+			exponent--;
+		}
+		bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+	}
+	float value;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+static double read_npy_item(const unsigned char* p, const NpyHeader& header) {
+	std::uint64_t bits = 0;
+	for (int i = 0; i < header.itemSize; ++i) {
+		const unsigned char byte = p[header.bigEndian ? header.itemSize - 1 - i : i];
+		bits |= (std::uint64_t)byte << (8 * i);
+	}
+	switch (header.kind) {
+	case 'b':
+		return bits != 0 ? 1.0 : 0.0;
+	case 'u':
+		return (double)bits;
+	case 'i':
+		if (header.itemSize < 8 && (bits >> (8 * header.itemSize - 1)) != 0) {
+			bits |= ~0ull << (8 * header.itemSize);
+		}
+		return (double)(std::int64_t)bits;
+	default:
+		if (header.itemSize == 2) {
+			return half_to_float((std::uint16_t)bits);
+		}
+		if (header.itemSize == 4) {
+			float value;
+			const std::uint32_t bits32 = (std::uint32_t)bits;
+			std::memcpy(&value, &bits32, sizeof(value));
+			return value;
+		}
+		double value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+}
+
+static void write_item(unsigned char* dst, int depth, double value) {
+	switch (depth) {
+	case CV_8U: *dst = (unsigned char)value; break;
+	case CV_8S: *(signed char*)dst = (signed char)value; break;
+	case CV_16U: *(std::uint16_t*)dst = (std::uint16_t)value; break;
+	case CV_16S: *(std::int16_t*)dst = (std::int16_t)value; break;
+	case CV_32S: *(std::int32_t*)dst = (std::int32_t)value; break;
+	case CV_32F: *(float*)dst = (float)value; break;
+	default: *(double*)dst = value; break;
+	}
+}
+
+// Turns the .npy bytes at `data` into frame `frame` of the array. With a `file` that
+// `data` points into, a C-order array in host byte order is wrapped without copying;
+// everything else (Fortran order, foreign byte order, widened dtypes, inflated members)
+// is gathered into a new Mat.
+static bool npy_to_mat(const unsigned char* data, size_t size, int frame, std::unique_ptr<MappedFile> file, cv::Mat& out, std::string& errorOut) {
+	NpyHeader header;
+	NpyLayout layout;
+	if (!parse_npy_header(data, size, header, errorOut) || !npy_layout(header, layout, errorOut)) {
+		return false;
+	}
+	const ArrayInfo& info = layout.info;
+	frame = std::max(0, frame);
+	if (frame >= info.frames) {
+		errorOut = "Frame " + std::to_string(frame) + " is past the end of the stack";
+		return false;
+	}
+	// Only the items of the requested frame have to be present, so a compressed member can
+	// be inflated just that far.
+	const std::uint64_t lastItem = (std::uint64_t)frame * layout.frameStep + (std::uint64_t)(info.height - 1) * layout.rowStep
+		+ (std::uint64_t)(info.width - 1) * layout.colStep + (std::uint64_t)(info.channels - 1) * layout.channelStep;
+	if (header.dataOffset + (lastItem + 1) * header.itemSize > size) {
+		errorOut = "Array data is truncated for shape " + shape_to_string(header.shape);
+		return false;
+	}
+
+	const int type = CV_MAKETYPE(info.depth, info.channels);
+	const unsigned char* base = data + header.dataOffset;
+	if (!header.fortranOrder && layout.direct) {
+		const unsigned char* pixels = base + (size_t)frame * layout.frameStep * header.itemSize;
+		const size_t step = (size_t)info.width * info.channels * header.itemSize;
+		if (file && (std::uintptr_t)pixels % header.itemSize == 0) {
+			out = wrap_mapped_pixels(std::move(file), pixels, info.height, info.width, type, step);
+		}
+		else {
+			out = cv::Mat(info.height, info.width, type, (void*)pixels, step).clone();
+		}
+		return true;
+	}
+
+	out.create(info.height, info.width, type);
+	const size_t outItem = CV_ELEM_SIZE1(info.depth);
+	const unsigned char* frameBase = base + (size_t)frame * layout.frameStep * header.itemSize;
+	for (int y = 0; y < info.height; ++y) {
+		unsigned char* row = out.ptr(y);
+		for (int x = 0; x < info.width; ++x) {
+			for (int c = 0; c < info.channels; ++c) {
+				const std::int64_t item = y * layout.rowStep + x * layout.colStep + c * layout.channelStep;
+				write_item(row + ((size_t)x * info.channels + c) * outItem, info.depth,
+					read_npy_item(frameBase + (size_t)item * header.itemSize, header));
+			}
+		}
+	}
+	return true;
+}
+
+// Central directory of an .npz (a zip archive), including the zip64 records numpy writes
+// for archives past 4 GB.
+static bool read_zip_directory(const MappedFile& archive, std::vector<ZipMember>& members, std::string& errorOut) {
+	const unsigned char* data = archive.data;
+	const size_t size = archive.size;
+	size_t eocd = std::string::npos;
+	for (size_t pos = size >= 22 ? size - 22 : 0; size >= 22 && size - pos <= 22 + 0xFFFF; --pos) {
+		if (le32(data + pos) == 0x06054b50) {
+			eocd = pos;
+			break;
+		}
+		if (pos == 0) {
+			break;
+		}
+	}
+	if (eocd == std::string::npos) {
+		errorOut = "Not an .npz archive";
+		return false;
+	}
+	std::uint64_t count = le16(data + eocd + 10);
+	std::uint64_t offset = le32(data + eocd + 16);
+	if ((count == 0xFFFF || offset == 0xFFFFFFFF) && eocd >= 20 && le32(data + eocd - 20) == 0x07064b50) {
+		const std::uint64_t zip64 = le64(data + eocd - 20 + 8);
+		if (zip64 + 56 <= size && le32(data + zip64) == 0x06064b50) {
+			count = le64(data + zip64 + 32);
+			offset = le64(data + zip64 + 48);
+		}
+	}
+
+	members.clear();
+	for (std::uint64_t i = 0; i < count; ++i) {
+		if (offset + 46 > size || le32(data + offset) != 0x02014b50) {
+			errorOut = "Corrupt .npz directory";
+			return false;
+		}
+		const unsigned char* entry = data + offset;
+		const size_t nameLength = le16(entry + 28);
+		const size_t extraLength = le16(entry + 30);
+		const size_t commentLength = le16(entry + 32);
+		if (offset + 46 + nameLength + extraLength > size) {
+			errorOut = "Corrupt .npz directory";
+			return false;
+		}
+		ZipMember member;
+		member.method = le16(entry + 10);
+		member.compressedSize = le32(entry + 20);
+		member.size = le32(entry + 24);
+		member.localOffset = le32(entry + 42);
+		member.name.assign((const char*)entry + 46, nameLength);
+		const unsigned char* extra = entry + 46 + nameLength;
+		for (size_t pos = 0; pos + 4 <= extraLength; pos += 4 + le16(extra + pos + 2)) {
+			if (le16(extra + pos) != 0x0001) {
+				continue;
+			}
+			// Zip64 sizes, present only for the fields saturated above, in this order.
+			const unsigned char* field = extra + pos + 4;
+			const size_t fieldLength = std::min<size_t>(le16(extra + pos + 2), extraLength - pos - 4);
+			size_t used = 0;
+			for (std::uint64_t* value : { &member.size, &member.compressedSize, &member.localOffset }) {
+				if (*value == 0xFFFFFFFF && used + 8 <= fieldLength) {
+					*value = le64(field + used);
+					used += 8;
+				}
+			}
+		}
+		members.push_back(std::move(member));
+		offset += 46 + nameLength + extraLength + commentLength;
+	}
+	return true;
+}
+
+static bool zip_member_data(const MappedFile& archive, const ZipMember& member, std::uint64_t& dataOffset, std::string& errorOut) {
+	const std::uint64_t local = member.localOffset;
+	if (local + 30 > archive.size || le32(archive.data + local) != 0x04034b50) {
+		errorOut = "Corrupt .npz member " + member.name;
+		return false;
+	}
+	dataOffset = local + 30 + le16(archive.data + local + 26) + le16(archive.data + local + 28);
+	if (dataOffset + member.compressedSize > archive.size) {
+		errorOut = "Truncated .npz member " + member.name;
+		return false;
+	}
+	if (member.method != 0 && member.method != Z_DEFLATED) {
+		errorOut = "Unsupported compression in .npz member " + member.name;
+		return false;
+	}
+	return true;
+}
+
+// Inflates the first `limit` bytes of a deflated member (fewer if it is shorter).
+static bool inflate_member(const MappedFile& archive, const ZipMember& member, std::uint64_t dataOffset, size_t limit,
+	std::vector<unsigned char>& out, std::string& errorOut) {
+	out.resize(limit);
+	z_stream stream{};
+	if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+		errorOut = "Cannot start inflating " + member.name;
+		return false;
+	}
+	const unsigned char* in = archive.data + dataOffset;
+	std::uint64_t inLeft = member.compressedSize;
+	size_t produced = 0;
+	int status = Z_OK;
+	const std::uint64_t kChunk = 1u << 30;
+	while (produced < limit && status != Z_STREAM_END) {
+		if (stream.avail_in == 0) {
+			if (inLeft == 0) {
+				break;
+			}
+			const uInt chunk = (uInt)std::min(inLeft, kChunk);
+			stream.next_in = (Bytef*)in;
+			stream.avail_in = chunk;
+			in += chunk;
+			inLeft -= chunk;
+		}
+		stream.next_out = out.data() + produced;
+		stream.avail_out = (uInt)std::min<std::uint64_t>(limit - produced, kChunk);
+		const uInt before = stream.avail_out;
+		status = inflate(&stream, Z_NO_FLUSH);
+		produced += before - stream.avail_out;
+		if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+			inflateEnd(&stream);
+			errorOut = "Corrupt compressed data in .npz member " + member.name;
+			return false;
+		}
+	}
+	inflateEnd(&stream);
+	out.resize(produced);
+	return true;
+}
+
+// The member's .npy header, inflating only as much as it takes.
+static bool read_member_header(const MappedFile& archive, const ZipMember& member, std::uint64_t dataOffset,
+	NpyHeader& header, std::vector<unsigned char>& bytes, std::string& errorOut) {
+	if (member.method == 0) {
+		return parse_npy_header(archive.data + dataOffset, (size_t)member.compressedSize, header, errorOut);
+	}
+	if (!inflate_member(archive, member, dataOffset, (size_t)std::min<std::uint64_t>(member.size, kNpyHeaderProbeBytes), bytes, errorOut)) {
+		return false;
+	}
+	if (bytes.size() >= 12 && parse_npy_header(bytes.data(), bytes.size(), header, errorOut)) {
+		return true;
+	}
+	// Headers are padded to 64 bytes and rarely reach the probe size; inflate the rest if so.
+	const size_t dictLength = bytes.size() >= 12 ? (bytes[6] == 1 ? le16(bytes.data() + 8) : le32(bytes.data() + 8)) : 0;
+	if (dictLength + 12 <= bytes.size() || dictLength + 12 > member.size) {
+		return false;
+	}
+	return inflate_member(archive, member, dataOffset, dictLength + 12, bytes, errorOut)
+		&& parse_npy_header(bytes.data(), bytes.size(), header, errorOut);
+}
+
+static std::string member_name(const ZipMember& member) {
+	const std::string& name = member.name;
+	return name.size() > 4 && to_lower(name.substr(name.size() - 4)) == ".npy" ? name.substr(0, name.size() - 4) : name;
+}
+
+// Shapes of every array in an .npy/.npz. Unsupported .npz members are left out; the call
+// fails only when nothing is left.
+bool list_array_members(const std::string& path, std::vector<ArrayInfo>& members, std::string& errorOut) {
+	members.clear();
+	MappedFile file;
+	if (!map_file(path, file, errorOut, MapAccess::Random)) {
+		return false;
+	}
+	if (!is_npz_file(path)) {
+		NpyHeader header;
+		NpyLayout layout;
+		if (!parse_npy_header(file.data, file.size, header, errorOut) || !npy_layout(header, layout, errorOut)) {
+			errorOut += ": " + path;
+			return false;
+		}
+		members.push_back(layout.info);
+		return true;
+	}
+
+	std::vector<ZipMember> entries;
+	if (!read_zip_directory(file, entries, errorOut)) {
+		errorOut += ": " + path;
+		return false;
+	}
+	std::string memberError;
+	for (const ZipMember& entry : entries) {
+		std::uint64_t dataOffset = 0;
+		NpyHeader header;
+		NpyLayout layout;
+		std::vector<unsigned char> bytes;
+		if (!zip_member_data(file, entry, dataOffset, memberError) || !read_member_header(file, entry, dataOffset, header, bytes, memberError)
+			|| !npy_layout(header, layout, memberError)) {
+			continue;
+		}
+		layout.info.member = member_name(entry);
+		members.push_back(layout.info);
+	}
+	if (members.empty()) {
+		errorOut = (memberError.empty() ? std::string("No arrays") : memberError) + ": " + path;
+		return false;
+	}
+	return true;
+}
+
+// Decodes the array (or stack frame) an entry path points at. Plain .npy files and stored
+// .npz members stay in the file mapping; compressed members are inflated only as far as
+// the requested frame.
+bool read_array_image(const std::string& path, cv::Mat& out, std::string& errorOut) {
+	std::string filePath, member;
+	int frame = -1;
+	split_array_path(path, filePath, member, frame);
+	// One frame of an .npy stack touches only its own slice of the file. A whole array is
+	// read through by the stats and preview passes, and .npz members inflate as streams.
+	const bool stackFrame = frame >= 0 && !is_npz_file(filePath);
+	auto file = std::make_unique<MappedFile>();
+	if (!map_file(filePath, *file, errorOut, stackFrame ? MapAccess::Random : MapAccess::Sequential)) {
+		return false;
+	}
+	if (!is_npz_file(filePath)) {
+		const unsigned char* data = file->data;
+		const size_t size = file->size;
+		return npy_to_mat(data, size, frame, std::move(file), out, errorOut);
+	}
+
+	std::vector<ZipMember> entries;
+	if (!read_zip_directory(*file, entries, errorOut)) {
+		return false;
+	}
+	auto entry = std::find_if(entries.begin(), entries.end(), [&member](const ZipMember& candidate) {
+		return member.empty() || member_name(candidate) == member;
+	});
+	if (entry == entries.end()) {
+		errorOut = "No array " + member + " in " + filePath;
+		return false;
+	}
+	std::uint64_t dataOffset = 0;
+	if (!zip_member_data(*file, *entry, dataOffset, errorOut)) {
+		return false;
+	}
+	if (entry->method == 0) {
+		const unsigned char* data = file->data + dataOffset;
+		return npy_to_mat(data, (size_t)entry->compressedSize, frame, std::move(file), out, errorOut);
+	}
+
+	NpyHeader header;
+	NpyLayout layout;
+	std::vector<unsigned char> bytes;
+	if (!read_member_header(*file, *entry, dataOffset, header, bytes, errorOut) || !npy_layout(header, layout, errorOut)) {
+		return false;
+	}
+	// A C-order stack needs nothing past the requested frame.
+	std::uint64_t needed = entry->size;
+	if (!header.fortranOrder && layout.info.frames > 1) {
+		needed = header.dataOffset + (std::uint64_t)(std::max(0, frame) + 1) * layout.frameStep * header.itemSize;
+	}
+	if (!inflate_member(*file, *entry, dataOffset, (size_t)std::min(needed, entry->size), bytes, errorOut)) {
+		return false;
+	}
+	return npy_to_mat(bytes.data(), bytes.size(), frame, nullptr, out, errorOut);
+}
+
+// Frame paths of the stack an entry path points into; `index` is the entry's own frame.
+bool find_array_frames(const std::string& path, std::vector<std::string>& frames, int& index) {
+	std::string file, member;
+	int frame = -1;
+	split_array_path(path, file, member, frame);
+	std::vector<ArrayInfo> members;
+	std::string error;
+	if (!list_array_members(file, members, error)) {
+		return false;
+	}
+	if (is_npz_file(file) && member.empty()) {
+		member = members.front().member;
+	}
+	auto info = std::find_if(members.begin(), members.end(), [&member](const ArrayInfo& candidate) {
+		return candidate.member == member;
+	});
+	if (info == members.end() || info->frames < 2) {
+		return false;
+	}
+	frames.clear();
+	frames.reserve(info->frames);
+	for (int i = 0; i < info->frames; ++i) {
+		frames.push_back(array_entry_path(file, member, i));
+	}
+	index = std::clamp(frame, 0, info->frames - 1);
+	return true;
+}
+
+// Number of list entries backed by `normalizedFile`; the members of one .npz share its watch.
+int count_array_file_entries(const ImageStates& states, const std::string& normalizedFile) {
+	int count = 0;
+	for (const ImageState& state : states.states) {
+		if (array_file_path(state.normalizedPath) == normalizedFile) {
+			count++;
+		}
+	}
+	return count;
+}
+
+// Adds one list entry per array in the file, sized from the headers. Nothing is read or
+// inflated until an entry is selected; stacks open as a sequence over their frames.
+void open_array_file(ImageStates& states, const fs::path& path) {
+	std::vector<ArrayInfo> members;
+	std::string error;
+	if (!list_array_members(path.string(), members, error)) {
+		showError(error.c_str());
+		return;
+	}
+	const std::string normalizedFile = normalize_path(path);
+	for (const ArrayInfo& info : members) {
+		const std::string normalizedPath = array_entry_path(normalizedFile, info.member, -1);
+		if (states.knownPaths.count(normalizedPath) != 0) {
+			continue;
+		}
+		ImageState& state = add_image_entry(states, fs::path(array_entry_path(path.string(), info.member, -1)), normalizedPath);
+		state.width = info.width;
+		state.height = info.height;
+		state.channels = info.channels;
+		state.depth = depth_to_string(info.depth);
+		state.loadStatus = LoadStatus::Unloaded;
+		if (info.frames > 1) {
+			std::string sequenceError;
+			open_sequence(state, sequenceError);
+		}
+	}
+}
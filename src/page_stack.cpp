@@ -0,0 +1,84 @@
+#include "ImagePixelViewer.h"
+
+// Pages after the first are addressed as "<file>::<page>", zero-based.
+static const char* kPageSeparator = "::";
+
+bool is_paged_ext(const std::string& extLower) {
+	return kPagedExt.count(extLower) != 0;
+}
+
+// Splits "<file>::<page>"; anything else is a whole file with page -1.
+static void split_page_path(const std::string& path, std::string& file, int& page) {
+	file = path;
+	page = -1;
+	const size_t pos = path.rfind(kPageSeparator);
+	if (pos == std::string::npos || pos + 2 == path.size()) {
+		return;
+	}
+	const std::string number = path.substr(pos + 2);
+	if (!std::all_of(number.begin(), number.end(), [](char c) { return std::isdigit((unsigned char)c) != 0; })) {
+		return;
+	}
+	const std::string candidate = path.substr(0, pos);
+	if (!is_paged_ext(to_lower(fs::path(candidate).extension().string()))) {
+		return;
+	}
+	file = candidate;
+	page = (int)std::strtol(number.c_str(), nullptr, 10);
+}
+
+std::string page_file_path(const std::string& path) {
+	std::string file;
+	int page = -1;
+	split_page_path(path, file, page);
+	return file;
+}
+
+int page_of_path(const std::string& path) {
+	std::string file;
+	int page = -1;
+	split_page_path(path, file, page);
+	return page;
+}
+
+// One page of a multi-page TIFF or one frame of an animated GIF/WebP. OpenCV walks the
+// earlier pages' headers to get there but decodes only the one asked for.
+bool read_image_page(const std::string& path, int page, cv::Mat& out, std::string& errorOut) {
+	std::vector<cv::Mat> pages;
+	if (!cv::imreadmulti(path, pages, page, 1, cv::IMREAD_UNCHANGED) || pages.empty() || pages.front().empty()) {
+		errorOut = "Cannot load page " + std::to_string(page + 1) + " of " + path;
+		return false;
+	}
+	out = pages.front();
+	return true;
+}
+
+// Makes a multi-page entry page-aware: its pages become the frames of a player, so the
+// arrow keys, the transport bar and the list row all work in pages. `firstPage`, when
+// given, is the decode that revealed the pages and seeds the cache with the page on screen.
+void open_page_stack(ImageState& state, int pageCount, const DecodeResult* firstPage) {
+	auto player = std::make_shared<SequencePlayer>();
+	const std::string file = page_file_path(state.currentPath);
+	const int page = std::clamp(page_of_path(state.currentPath), 0, pageCount - 1);
+	player->pages = true;
+	player->loop = false;
+	player->frames.reserve(pageCount);
+	for (int i = 0; i < pageCount; ++i) {
+		player->frames.push_back(file + kPageSeparator + std::to_string(i));
+	}
+	player->frameCount = pageCount;
+	player->current = page;
+	player->requested = page;
+	player->anchorFrame = page;
+	player->ring.resize(std::min(kPageCacheFrames, pageCount));
+	if (firstPage != nullptr) {
+		SequenceSlot& slot = player->ring.front();
+		slot.frame = page;
+		slot.serial = ++player->nextSerial;
+		slot.ready = true;
+		slot.lastShown = ++player->shown;
+		slot.result = *firstPage;
+		slot.result.sequenceFrame = page;
+	}
+	state.sequence = std::move(player);
+}
@@ -0,0 +1,118 @@
+#include "ImagePixelViewer.h"
+
+// Upper bound on what a decoded image holds in memory: source pixels at full resolution,
+// the RGBA preview and its pyramid (a third on top). Proxies come in below this.
+std::uint64_t estimated_image_bytes(const ImageState& state) {
+	const std::uint64_t elemSize = (state.depth == "16U" || state.depth == "16S") ? 2
+		: (state.depth == "32S" || state.depth == "32F") ? 4 : (state.depth == "64F") ? 8 : 1;
+	const std::uint64_t pixels = (std::uint64_t)state.width * state.height;
+	return pixels * std::max(1, state.channels) * elemSize + pixels * 6;
+}
+
+static std::uint64_t resident_image_bytes(const ImageState& state) {
+	std::uint64_t bytes = state.sourceOriginal.total() * state.sourceOriginal.elemSize()
+		+ state.previewRGBA.total() * state.previewRGBA.elemSize();
+	for (const cv::Mat& level : state.previewPyramid) {
+		bytes += level.total() * level.elemSize();
+	}
+	return bytes;
+}
+
+// Drops the pixels of a decoded image. The list keeps its metadata and thumbnail, and the
+// image decodes again when it is selected or comes back into the prefetch window.
+void unload_image(ImageStates& states, ImageState& state) {
+	release_image_tiles(states.tiles, state.uid);
+	state.sourceOriginal.release();
+	state.previewRGBA.release();
+	state.previewPyramid.clear();
+	state.previewVersion++;
+	// Results still in flight for the old pixels are dropped by the serial checks.
+	state.decodeSerial++;
+	state.previewSerial++;
+	state.previewPending = false;
+	state.proxyScale = 1;
+	state.fullResPending = false;
+	state.exactTile.release();
+	state.exactTileRect = cv::Rect();
+	state.loadStatus = LoadStatus::Unloaded;
+	if (state.sequence) {
+		release_sequence_frames(*state.sequence);
+	}
+}
+
+void select_image(ImageStates& states, int index) {
+	if (states.states.empty()) {
+		return;
+	}
+	index = std::clamp(index, 0, (int)states.states.size() - 1);
+	if (index != states.selected) {
+		states.selected = index;
+		states.scrollToSelected = true;
+	}
+}
+
+// Called once per frame. Keeps up to prefetchRadius images on either side of the selection
+// decoded, nearest first, and gives back the pixels of the images farthest from the
+// selection once the decoded total exceeds prefetchBudgetMB. The selected image is never
+// unloaded; it is decoded by the canvas on demand.
+void prefetch_neighbors(ImageStates& states) {
+	const int count = (int)states.states.size();
+	if (count == 0) {
+		return;
+	}
+	const int selected = states.selected;
+	const std::uint64_t budget = (std::uint64_t)states.prefetchBudgetMB * 1024 * 1024;
+
+	std::uint64_t resident = 0;
+	for (const ImageState& state : states.states) {
+		if (state.loadStatus == LoadStatus::Ready) {
+			resident += resident_image_bytes(state);
+		}
+		else if (states.prefetchDecodes.count(state.uid) != 0) {
+			resident += estimated_image_bytes(state);
+		}
+	}
+
+	if (resident > budget) {
+		std::vector<int> loaded;
+		for (int i = 0; i < count; ++i) {
+			if (i != selected && states.states[i].loadStatus == LoadStatus::Ready && !states.states[i].sourceOriginal.empty()) {
+				loaded.push_back(i);
+			}
+		}
+		std::sort(loaded.begin(), loaded.end(), [selected](int a, int b) {
+			return std::abs(a - selected) > std::abs(b - selected);
+		});
+		for (int i : loaded) {
+			if (resident <= budget) {
+				break;
+			}
+			ImageState& state = states.states[i];
+			resident -= resident_image_bytes(state);
+			unload_image(states, state);
+		}
+	}
+
+	// The estimate never undercounts a decode, so an image evicted above is not
+	// prefetched straight back.
+	for (int distance = 1; distance <= states.prefetchRadius; ++distance) {
+		for (int index : { selected + distance, selected - distance }) {
+			if (index < 0 || index >= count) {
+				continue;
+			}
+			ImageState& state = states.states[index];
+			if (state.loadStatus != LoadStatus::Unloaded) {
+				continue;
+			}
+			const std::uint64_t estimate = estimated_image_bytes(state);
+			if (resident + estimate > budget) {
+				return;
+			}
+			queue_prefetch_decode(states, state);
+			if (state.loadStatus == LoadStatus::Unloaded) {
+				return; // enough prefetches in flight
+			}
+			resident += estimate;
+		}
+	}
+}
@@ -0,0 +1,227 @@
+#include "ImagePixelViewer.h"
+
+// Fused preview kernel: one read of sourceOriginal, one write of the RGBA upload buffer.
+// It replaces the old split/convertTo/minMaxLoc/merge/cvtColor/applyColorMap chain and
+// reproduces its results: same saturation, same BT.601 gray weights, same TURBO colormap.
+
+enum PreviewKernelFlags {
+	kPreviewGray = 1,
+	kPreviewContrast = 2,
+	kPreviewPseudo = 4,
+	kPreviewIgnoreAlpha = 8,
+};
+
+// Per-channel linear map used by auto contrast: dst = src * scale + shift.
+struct ContrastMap {
+	std::array<float, 4> scale{};
+	std::array<float, 4> shift{};
+};
+
+// Value type between load and output. Auto contrast always lands in 8 bit; otherwise
+// signed types are saturated to their unsigned peer and wide types go to float.
+template <typename S, bool Contrast> struct PreviewWorkType { using type = float; };
+template <typename S> struct PreviewWorkType<S, true> { using type = uchar; };
+template <> struct PreviewWorkType<uchar, false> { using type = uchar; };
+template <> struct PreviewWorkType<schar, false> { using type = uchar; };
+template <> struct PreviewWorkType<ushort, false> { using type = ushort; };
+template <> struct PreviewWorkType<short, false> { using type = ushort; };
+
+template <typename W> constexpr W preview_opaque() { return std::numeric_limits<W>::max(); }
+template <> constexpr float preview_opaque<float>() { return 1.0f; }
+
+// Same fixed-point weights cvtColor uses for 8U/16U BGR2GRAY.
+template <typename W> inline W preview_gray(W b, W g, W r) {
+	return (W)(((int)b * 1868 + (int)g * 9617 + (int)r * 4899 + (1 << 13)) >> 14);
+}
+template <> inline float preview_gray<float>(float b, float g, float r) {
+	return b * 0.114f + g * 0.587f + r * 0.299f;
+}
+
+static const std::array<cv::Vec4b, 256>& turbo_lut() {
+	static std::array<cv::Vec4b, 256> lut;
+	static std::once_flag once;
+	std::call_once(once, [] {
+		cv::Mat ramp(256, 1, CV_8UC1);
+		for (int i = 0; i < 256; ++i) {
+			ramp.at<uchar>(i, 0) = (uchar)i;
+		}
+		cv::Mat colorBgr;
+		cv::applyColorMap(ramp, colorBgr, cv::COLORMAP_TURBO);
+		for (int i = 0; i < 256; ++i) {
+			const cv::Vec3b bgr = colorBgr.at<cv::Vec3b>(i, 0);
+			lut[i] = cv::Vec4b(bgr[2], bgr[1], bgr[0], 255);
+		}
+	});
+	return lut;
+}
+
+template <typename S, int CN, int Flags>
+struct PreviewKernel {
+	static constexpr bool Contrast = (Flags & kPreviewContrast) != 0;
+	static constexpr bool Gray = (Flags & kPreviewGray) != 0 && CN > 1;
+	static constexpr int ShownCN = Gray ? 1 : CN;
+	static constexpr bool Pseudo = (Flags & kPreviewPseudo) != 0 && ShownCN == 1;
+	static constexpr bool IgnoreAlpha = (Flags & kPreviewIgnoreAlpha) != 0 && ShownCN == 4;
+	using W = typename PreviewWorkType<S, Contrast>::type;
+	using O = typename std::conditional<Pseudo, uchar, W>::type;
+
+	static int output_type() { return CV_MAKETYPE(cv::DataType<O>::depth, 4); }
+
+	static void rows(const cv::Mat& src, cv::Mat& dst, const ContrastMap& map, int y0, int y1) {
+		const std::array<cv::Vec4b, 256>* lut = Pseudo ? &turbo_lut() : nullptr;
+		for (int y = y0; y < y1; ++y) {
+			const S* s = src.ptr<S>(y);
+			O* d = dst.ptr<O>(y);
+			for (int x = 0; x < src.cols; ++x, s += CN, d += 4) {
+				W w[CN];
+				for (int c = 0; c < CN; ++c) {
+					if constexpr (Contrast) {
+						if (CN == 4 && c == 3) {
+							w[c] = cv::saturate_cast<uchar>(s[c]);
+						}
+						else {
+							w[c] = cv::saturate_cast<uchar>((float)s[c] * map.scale[c] + map.shift[c]);
+						}
+					}
+					else {
+						w[c] = cv::saturate_cast<W>(s[c]);
+					}
+				}
+
+				if constexpr (Gray) {
+					w[0] = preview_gray<W>(w[0], w[1], w[2]);
+				}
+
+				if constexpr (Pseudo) {
+					const cv::Vec4b& rgba = (*lut)[cv::saturate_cast<uchar>(w[0])];
+					d[0] = rgba[0];
+					d[1] = rgba[1];
+					d[2] = rgba[2];
+					d[3] = rgba[3];
+				}
+				else if constexpr (ShownCN == 1) {
+					d[0] = d[1] = d[2] = w[0];
+					d[3] = preview_opaque<W>();
+				}
+				else {
+					d[0] = w[2];
+					d[1] = w[1];
+					d[2] = w[0];
+					if constexpr (ShownCN == 4 && !IgnoreAlpha) {
+						d[3] = w[3];
+					}
+					else {
+						d[3] = preview_opaque<W>();
+					}
+				}
+			}
+		}
+	}
+
+	static void run(const cv::Mat& src, cv::Mat& dst, const ContrastMap& map, const CancelToken& cancel) {
+		dst.create(src.rows, src.cols, output_type());
+		// Row strips sized to stay in L2 keep both streams cache-resident per worker.
+		const size_t rowBytes = std::max<size_t>(1, (size_t)src.cols * (src.elemSize() + dst.elemSize()));
+		const int stripRows = (int)std::max<size_t>(1, (256 * 1024) / rowBytes);
+		const int strips = (src.rows + stripRows - 1) / stripRows;
+		cv::parallel_for_(cv::Range(0, strips), [&](const cv::Range& range) {
+			for (int strip = range.start; strip < range.end; ++strip) {
+				if (cancel.requested()) {
+					return;
+				}
+				const int y0 = strip * stripRows;
+				rows(src, dst, map, y0, std::min(src.rows, y0 + stripRows));
+			}
+		});
+	}
+};
+
+template <typename S, int CN, int... Flags>
+static void run_preview_kernel(int flags, const cv::Mat& src, cv::Mat& dst, const ContrastMap& map,
+	const CancelToken& cancel, std::integer_sequence<int, Flags...>) {
+	(void)((flags == Flags ? (PreviewKernel<S, CN, Flags>::run(src, dst, map, cancel), true) : false) || ...);
+}
+
+template <typename S>
+static bool run_preview_for_channels(int flags, const cv::Mat& src, cv::Mat& dst, const ContrastMap& map, const CancelToken& cancel) {
+	using AllFlags = std::make_integer_sequence<int, 16>;
+	switch (src.channels()) {
+	case 1: run_preview_kernel<S, 1>(flags, src, dst, map, cancel, AllFlags{}); return true;
+	case 3: run_preview_kernel<S, 3>(flags, src, dst, map, cancel, AllFlags{}); return true;
+	case 4: run_preview_kernel<S, 4>(flags, src, dst, map, cancel, AllFlags{}); return true;
+	default: return false;
+	}
+}
+
+// `stats` supplies the auto-contrast range, so toggling modes never rescans the source.
+bool render_preview_rgba(const cv::Mat& source, const ImageStats& stats, const PreviewOptions& options, PreviewImages& out, std::string& errorOut, const CancelToken& cancel) {
+	if (source.empty()) {
+		errorOut = "No source image available.";
+		return false;
+	}
+	const int channels = source.channels();
+	if (channels != 1 && channels != 3 && channels != 4) {
+		errorOut = "Unsupported channel count: " + std::to_string(channels);
+		return false;
+	}
+
+	int flags = 0;
+	flags |= options.gray ? kPreviewGray : 0;
+	flags |= options.autoContrast ? kPreviewContrast : 0;
+	flags |= options.pseudoColor ? kPreviewPseudo : 0;
+	flags |= options.ignoreAlpha ? kPreviewIgnoreAlpha : 0;
+
+	ContrastMap map;
+	out.hasMinMax = false;
+	out.minVal = 0.0;
+	out.maxVal = 0.0;
+	if (options.autoContrast) {
+		// Alpha is passed through, not stretched.
+		const int colorChannels = (channels == 4) ? 3 : channels;
+		if (!stats.valid || (int)stats.channels.size() < colorChannels) {
+			errorOut = "Image statistics are not available.";
+			return false;
+		}
+
+		double minAcross = std::numeric_limits<double>::infinity();
+		double maxAcross = -std::numeric_limits<double>::infinity();
+		for (int c = 0; c < colorChannels; ++c) {
+			const ChannelStats& channel = stats.channels[c];
+			if (channel.finiteCount == 0) {
+				continue; // all non-finite: maps to 0
+			}
+			minAcross = std::min(minAcross, channel.minVal);
+			maxAcross = std::max(maxAcross, channel.maxVal);
+			if (!(channel.maxVal > channel.minVal)) {
+				continue; // flat channel maps to 0
+			}
+			const double scale = 255.0 / (channel.maxVal - channel.minVal);
+			map.scale[c] = (float)scale;
+			map.shift[c] = (float)(-channel.minVal * scale);
+		}
+		out.minVal = std::isfinite(minAcross) ? minAcross : 0.0;
+		out.maxVal = std::isfinite(maxAcross) ? maxAcross : 0.0;
+		out.hasMinMax = true;
+	}
+
+	bool supported = false;
+	switch (source.depth()) {
+	case CV_8U:  supported = run_preview_for_channels<uchar>(flags, source, out.previewRGBA, map, cancel); break;
+	case CV_8S:  supported = run_preview_for_channels<schar>(flags, source, out.previewRGBA, map, cancel); break;
+	case CV_16U: supported = run_preview_for_channels<ushort>(flags, source, out.previewRGBA, map, cancel); break;
+	case CV_16S: supported = run_preview_for_channels<short>(flags, source, out.previewRGBA, map, cancel); break;
+	case CV_32S: supported = run_preview_for_channels<int>(flags, source, out.previewRGBA, map, cancel); break;
+	case CV_32F: supported = run_preview_for_channels<float>(flags, source, out.previewRGBA, map, cancel); break;
+	case CV_64F: supported = run_preview_for_channels<double>(flags, source, out.previewRGBA, map, cancel); break;
+	default: break;
+	}
+	if (!supported) {
+		errorOut = "Unsupported image depth.";
+		return false;
+	}
+	if (cancel.requested()) {
+		errorOut = "Preview rebuild cancelled.";
+		return false;
+	}
+	return true;
+}
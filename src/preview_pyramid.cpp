@@ -0,0 +1,97 @@
+#include "ImagePixelViewer.h"
+
+// Halving pyramid of previewRGBA. The canvas draws from the level closest to the
+// on-screen scale, so zoomed-out views read a fraction of the pixels and do not alias.
+
+template <typename T> inline T pyramid_average(double sum, int n) {
+	return cv::saturate_cast<T>(sum / n);
+}
+template <> inline float pyramid_average<float>(double sum, int n) { return (float)(sum / n); }
+
+// One output pixel from the up-to-2x2 source block. Area mode averages it; extreme mode
+// keeps whichever whole pixel stands out most from the block, so a single hot or dead
+// pixel survives every level instead of being averaged away.
+template <typename T, bool KeepExtremes>
+static void halve_rows(const cv::Mat& src, cv::Mat& dst, int y0, int y1) {
+	for (int y = y0; y < y1; ++y) {
+		const int sy0 = y * 2;
+		const int sy1 = std::min(sy0 + 1, src.rows - 1);
+		const T* rows[2] = { src.ptr<T>(sy0), src.ptr<T>(sy1) };
+		T* d = dst.ptr<T>(y);
+		for (int x = 0; x < dst.cols; ++x, d += 4) {
+			const int sx0 = x * 2;
+			const int sx1 = std::min(sx0 + 1, src.cols - 1);
+			const T* block[4] = { rows[0] + sx0 * 4, rows[0] + sx1 * 4, rows[1] + sx0 * 4, rows[1] + sx1 * 4 };
+			if constexpr (KeepExtremes) {
+				double luma[4];
+				double mean = 0.0;
+				for (int i = 0; i < 4; ++i) {
+					luma[i] = 0.299 * block[i][0] + 0.587 * block[i][1] + 0.114 * block[i][2];
+					mean += luma[i];
+				}
+				mean *= 0.25;
+				int pick = 0;
+				for (int i = 1; i < 4; ++i) {
+					if (std::abs(luma[i] - mean) > std::abs(luma[pick] - mean)) {
+						pick = i;
+					}
+				}
+				std::memcpy(d, block[pick], 4 * sizeof(T));
+			}
+			else {
+				for (int c = 0; c < 4; ++c) {
+					const double sum = (double)block[0][c] + block[1][c] + block[2][c] + block[3][c];
+					d[c] = pyramid_average<T>(sum, 4);
+				}
+			}
+		}
+	}
+}
+
+template <typename T>
+static void halve_level(const cv::Mat& src, cv::Mat& dst, bool keepExtremes) {
+	dst.create((src.rows + 1) / 2, (src.cols + 1) / 2, src.type());
+	cv::parallel_for_(cv::Range(0, dst.rows), [&](const cv::Range& range) {
+		if (keepExtremes) {
+			halve_rows<T, true>(src, dst, range.start, range.end);
+		}
+		else {
+			halve_rows<T, false>(src, dst, range.start, range.end);
+		}
+	});
+}
+
+// Returns false only when cancelled.
+bool build_preview_pyramid(const cv::Mat& rgba, bool keepExtremes, std::vector<cv::Mat>& levels, const CancelToken& cancel) {
+	levels.clear();
+	if (rgba.empty() || rgba.channels() != 4) {
+		return true;
+	}
+	const cv::Mat* previous = &rgba;
+	while (std::max(previous->cols, previous->rows) > kPyramidMinSide) {
+		if (cancel.requested()) {
+			levels.clear();
+			return false;
+		}
+		cv::Mat next;
+		switch (rgba.depth()) {
+		case CV_8U:  halve_level<uchar>(*previous, next, keepExtremes); break;
+		case CV_16U: halve_level<ushort>(*previous, next, keepExtremes); break;
+		case CV_32F: halve_level<float>(*previous, next, keepExtremes); break;
+		default: return true;
+		}
+		levels.push_back(next);
+		previous = &levels.back();
+	}
+	return true;
+}
+
+// Level 0 is previewRGBA; level n is previewPyramid[n - 1]. Picks the largest level that
+// is still sampled at one texel per screen pixel or denser.
+int pyramid_level_for_zoom(const ImageState& state, float zoom) {
+	if (zoom <= 0.0f || zoom >= 0.5f) {
+		return 0;
+	}
+	const int level = (int)std::floor(std::log2(1.0f / zoom));
+	return std::clamp(level, 0, (int)state.previewPyramid.size());
+}
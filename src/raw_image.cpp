@@ -0,0 +1,279 @@
+#include "ImagePixelViewer.h"
+
+#include <fstream>
+
+// Per-file layout: "<file>.ipvraw" next to it. Per-folder layout: ".ipvraw" in the folder.
+static const char* kRawSidecarSuffix = ".ipvraw";
+static const char* kRawFolderFile = ".ipvraw";
+
+struct RawDepthName {
+	int depth;
+	const char* name;
+};
+
+static const RawDepthName kRawDepths[] = {
+	{ CV_8U, "uint8" }, { CV_8S, "int8" }, { CV_16U, "uint16" }, { CV_16S, "int16" },
+	{ CV_32S, "int32" }, { CV_32F, "float32" }, { CV_64F, "float64" },
+};
+
+// Layouts confirmed in the Raw Import dialog this session, so files in a read-only folder
+// still open. Decodes run on workers, hence the lock.
+static std::mutex gSessionLayoutsMutex;
+static std::unordered_map<std::string, RawFormat> gSessionLayouts;
+
+bool is_raw_ext(const std::string& extLower) {
+	return kRawExt.count(extLower) != 0;
+}
+
+static bool parse_raw_format(const fs::path& file, RawFormat& format) {
+	std::ifstream in(file);
+	if (!in) {
+		return false;
+	}
+	RawFormat parsed;
+	std::string line;
+	while (std::getline(in, line)) {
+		const size_t eq = line.find('=');
+		if (eq == std::string::npos) {
+			continue;
+		}
+		const std::string key = line.substr(0, eq);
+		const std::string value = line.substr(eq + 1);
+		try {
+			if (key == "width") parsed.width = std::stoi(value);
+			else if (key == "height") parsed.height = std::stoi(value);
+			else if (key == "channels") parsed.channels = std::stoi(value);
+			else if (key == "stride") parsed.stride = std::stoll(value);
+			else if (key == "offset") parsed.offset = std::stoll(value);
+			else if (key == "endian") parsed.bigEndian = (value == "big");
+			else if (key == "dtype") {
+				for (const RawDepthName& entry : kRawDepths) {
+					if (value == entry.name) {
+						parsed.depth = entry.depth;
+					}
+				}
+			}
+		}
+		catch (const std::exception&) {
+			return false;
+		}
+	}
+	if (parsed.width <= 0 || parsed.height <= 0 || parsed.channels < 1 || parsed.channels > 4) {
+		return false;
+	}
+	format = parsed;
+	return true;
+}
+
+// The file's own sidecar wins over this session's choice, which wins over the folder default.
+bool read_raw_format(const std::string& path, RawFormat& format, std::string& errorOut) {
+	const fs::path file(path);
+	if (parse_raw_format(fs::path(path + kRawSidecarSuffix), format)) {
+		return true;
+	}
+	{
+		std::lock_guard<std::mutex> lock(gSessionLayoutsMutex);
+		auto it = gSessionLayouts.find(normalize_path(file));
+		if (it != gSessionLayouts.end()) {
+			format = it->second;
+			return true;
+		}
+	}
+	if (parse_raw_format(file.parent_path() / kRawFolderFile, format)) {
+		return true;
+	}
+	errorOut = "No raw layout saved for " + path;
+	return false;
+}
+
+bool write_raw_format(const std::string& path, const RawFormat& format, bool sidecar, std::string& errorOut) {
+	const fs::path target = sidecar ? fs::path(path + kRawSidecarSuffix) : fs::path(path).parent_path() / kRawFolderFile;
+	std::ofstream out(target, std::ios::trunc);
+	const char* dtype = "uint8";
+	for (const RawDepthName& entry : kRawDepths) {
+		if (entry.depth == format.depth) {
+			dtype = entry.name;
+		}
+	}
+	out << "width=" << format.width << "\n"
+		<< "height=" << format.height << "\n"
+		<< "channels=" << format.channels << "\n"
+		<< "dtype=" << dtype << "\n"
+		<< "endian=" << (format.bigEndian ? "big" : "little") << "\n"
+		<< "stride=" << format.stride << "\n"
+		<< "offset=" << format.offset << "\n";
+	if (!out) {
+		errorOut = "Cannot write " + target.string();
+		return false;
+	}
+	return true;
+}
+
+static std::int64_t raw_row_bytes(const RawFormat& format) {
+	return (std::int64_t)format.width * format.channels * CV_ELEM_SIZE1(format.depth);
+}
+
+// Bytes the layout needs from the start of the file.
+static std::int64_t raw_required_bytes(const RawFormat& format) {
+	const std::int64_t rowBytes = raw_row_bytes(format);
+	const std::int64_t stride = format.stride > 0 ? format.stride : rowBytes;
+	return format.offset + stride * (format.height - 1) + rowBytes;
+}
+
+static bool host_is_big_endian() {
+	const std::uint16_t probe = 1;
+	return *reinterpret_cast<const unsigned char*>(&probe) == 0;
+}
+
+static void swap_element_bytes(cv::Mat& mat) {
+	const size_t elemSize = mat.elemSize1();
+	const size_t rowElems = (size_t)mat.cols * mat.channels();
+	for (int y = 0; y < mat.rows; ++y) {
+		unsigned char* p = mat.ptr<unsigned char>(y);
+		for (size_t i = 0; i < rowElems; ++i, p += elemSize) {
+			std::reverse(p, p + elemSize);
+		}
+	}
+}
+
+// Wraps the file's pixels as a cv::Mat without copying them, so opening a multi-GB dump
+// costs a mapping and format_pixel_value reads straight from the page cache. Layouts the
+// Mat cannot describe directly (foreign byte order, rows not aligned to the element size)
+// are copied once instead.
+bool map_raw_image(const std::string& path, const RawFormat& format, cv::Mat& out, std::string& errorOut) {
+	const int type = CV_MAKETYPE(format.depth, format.channels);
+	const size_t elemSize1 = CV_ELEM_SIZE1(format.depth);
+	const size_t stride = format.stride > 0 ? (size_t)format.stride : (size_t)raw_row_bytes(format);
+	const bool swapBytes = elemSize1 > 1 && format.bigEndian != host_is_big_endian();
+	const bool aligned = (stride % elemSize1) == 0 && ((size_t)format.offset % elemSize1) == 0;
+
+	// Sequential either way: the stats and preview passes read every pixel of the dump,
+	// wrapped in place or not, and want the readahead.
+	auto file = std::make_unique<MappedFile>();
+	if (!map_file(path, *file, errorOut)) {
+		return false;
+	}
+	const std::int64_t required = raw_required_bytes(format);
+	if (format.offset < 0 || required > (std::int64_t)file->size) {
+		errorOut = "Raw layout needs " + std::to_string(required) + " bytes but " + path + " has " + std::to_string(file->size);
+		return false;
+	}
+	const unsigned char* pixels = file->data + format.offset;
+
+	if (swapBytes || !aligned) {
+		out.create(format.height, format.width, type);
+		for (int y = 0; y < format.height; ++y) {
+			std::memcpy(out.ptr(y), pixels + (size_t)y * stride, (size_t)raw_row_bytes(format));
+		}
+		if (swapBytes) {
+			swap_element_bytes(out);
+		}
+		return true;
+	}
+
+	out = wrap_mapped_pixels(std::move(file), pixels, format.height, format.width, type, stride);
+	return true;
+}
+
+static void queue_raw_file(ImageStates& states, const std::string& path, const RawFormat& format) {
+	const fs::path p(path);
+	const std::string normalizedPath = normalize_path(p);
+	{
+		std::lock_guard<std::mutex> lock(gSessionLayoutsMutex);
+		gSessionLayouts[normalizedPath] = format;
+	}
+	if (states.knownPaths.count(normalizedPath) != 0) {
+		return;
+	}
+	queue_image_decode(states, add_image_entry(states, p, normalizedPath));
+}
+
+// Asks for the layout of dropped raw files that have none saved yet, stores it per folder
+// (or per file) and then opens them like any other image.
+void draw_raw_import_dialog(ImageStates& states) {
+	if (states.pendingRawPaths.empty()) {
+		return;
+	}
+	if (!ImGui::IsPopupOpen("Raw Import")) {
+		ImGui::OpenPopup("Raw Import");
+	}
+	if (!ImGui::BeginPopupModal("Raw Import", nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
+		return;
+	}
+
+	RawFormat& draft = states.rawDraft;
+	const std::string& first = states.pendingRawPaths.front();
+	ImGui::Text("%s%s", fs::path(first).filename().u8string().c_str(),
+		states.pendingRawPaths.size() > 1 ? (" and " + std::to_string(states.pendingRawPaths.size() - 1) + " more").c_str() : "");
+
+	ImGui::SetNextItemWidth(120.0f);
+	ImGui::InputInt("Width", &draft.width);
+	ImGui::SetNextItemWidth(120.0f);
+	ImGui::InputInt("Height", &draft.height);
+	ImGui::SetNextItemWidth(120.0f);
+	ImGui::SliderInt("Channels", &draft.channels, 1, 4);
+	int depthIndex = 0;
+	for (int i = 0; i < IM_ARRAYSIZE(kRawDepths); ++i) {
+		if (kRawDepths[i].depth == draft.depth) {
+			depthIndex = i;
+		}
+	}
+	ImGui::SetNextItemWidth(120.0f);
+	if (ImGui::BeginCombo("Type", kRawDepths[depthIndex].name)) {
+		for (int i = 0; i < IM_ARRAYSIZE(kRawDepths); ++i) {
+			if (ImGui::Selectable(kRawDepths[i].name, i == depthIndex)) {
+				draft.depth = kRawDepths[i].depth;
+			}
+		}
+		ImGui::EndCombo();
+	}
+	int endian = draft.bigEndian ? 1 : 0;
+	ImGui::RadioButton("Little endian", &endian, 0);
+	ImGui::SameLine();
+	ImGui::RadioButton("Big endian", &endian, 1);
+	draft.bigEndian = endian == 1;
+	ImGui::SetNextItemWidth(120.0f);
+	ImGui::InputScalar("Row stride (0 = packed)", ImGuiDataType_S64, &draft.stride);
+	ImGui::SetNextItemWidth(120.0f);
+	ImGui::InputScalar("Header offset", ImGuiDataType_S64, &draft.offset);
+	ImGui::Checkbox("Save for this file only", &states.rawDraftSidecar);
+
+	draft.width = std::max(0, draft.width);
+	draft.height = std::max(0, draft.height);
+	draft.stride = std::max<std::int64_t>(0, draft.stride);
+	draft.offset = std::max<std::int64_t>(0, draft.offset);
+
+	std::error_code sizeError;
+	const std::uintmax_t fileSize = fs::file_size(fs::path(first), sizeError);
+	const bool packedOk = draft.stride == 0 || draft.stride >= raw_row_bytes(draft);
+	const bool valid = draft.width > 0 && draft.height > 0 && packedOk && !sizeError
+		&& raw_required_bytes(draft) <= (std::int64_t)fileSize;
+	if (draft.width > 0 && draft.height > 0) {
+		ImGui::TextColored(valid ? ImVec4(0.2f, 0.6f, 0.2f, 1.0f) : ImVec4(0.8f, 0.2f, 0.2f, 1.0f),
+			"Layout needs %lld bytes, file has %llu", (long long)raw_required_bytes(draft), (unsigned long long)fileSize);
+	}
+
+	ImGui::BeginDisabled(!valid);
+	if (ImGui::Button("Open", ImVec2(100.0f, 0.0f))) {
+		std::unordered_set<std::string> savedFolders;
+		for (const std::string& path : states.pendingRawPaths) {
+			const std::string folder = fs::path(path).parent_path().string();
+			if (states.rawDraftSidecar || savedFolders.insert(folder).second) {
+				std::string writeError;
+				if (!write_raw_format(path, draft, states.rawDraftSidecar, writeError)) {
+					std::fprintf(stderr, "%s\n", writeError.c_str());
+				}
+			}
+			queue_raw_file(states, path, draft);
+		}
+		states.pendingRawPaths.clear();
+		ImGui::CloseCurrentPopup();
+	}
+	ImGui::EndDisabled();
+	ImGui::SameLine();
+	if (ImGui::Button("Cancel", ImVec2(100.0f, 0.0f))) {
+		states.pendingRawPaths.clear();
+		ImGui::CloseCurrentPopup();
+	}
+	ImGui::EndPopup();
+}
@@ -0,0 +1,460 @@
+#include "ImagePixelViewer.h"
+
+// Splits a filename around the last run of digits in its stem: "cam0_frame_000123.png"
+// gives "cam0_frame_", 123 and ".png". False when the stem has no digits.
+static bool split_frame_number(const std::string& filename, std::string& prefix, std::string& suffix, long long& number) {
+	const size_t dot = filename.find_last_of('.');
+	size_t end = (dot == std::string::npos) ? filename.size() : dot;
+	while (end > 0 && !std::isdigit((unsigned char)filename[end - 1])) {
+		end--;
+	}
+	size_t begin = end;
+	while (begin > 0 && std::isdigit((unsigned char)filename[begin - 1])) {
+		begin--;
+	}
+	if (begin == end || end - begin > 18) {
+		return false;
+	}
+	prefix = filename.substr(0, begin);
+	suffix = filename.substr(end);
+	number = std::stoll(filename.substr(begin, end - begin));
+	return true;
+}
+
+// Collects the files next to `path` that differ from it only in the frame number, in
+// numeric order so unpadded numbering sorts correctly. `index` is the position of `path`.
+bool find_sequence_frames(const fs::path& path, std::vector<std::string>& frames, int& index) {
+	std::string prefix, suffix;
+	long long number = 0;
+	if (!split_frame_number(path.filename().string(), prefix, suffix, number)) {
+		return false;
+	}
+
+	std::vector<std::pair<long long, std::string>> found;
+	const fs::path folder = path.has_parent_path() ? path.parent_path() : fs::path(".");
+	std::error_code ec;
+	fs::directory_iterator it(folder, fs::directory_options::skip_permission_denied, ec);
+	for (; !ec && it != fs::directory_iterator(); it.increment(ec)) {
+		std::error_code entryError;
+		if (!it->is_regular_file(entryError)) {
+			continue;
+		}
+		std::string otherPrefix, otherSuffix;
+		long long otherNumber = 0;
+		if (split_frame_number(it->path().filename().string(), otherPrefix, otherSuffix, otherNumber)
+			&& otherPrefix == prefix && otherSuffix == suffix) {
+			found.emplace_back(otherNumber, it->path().string());
+		}
+	}
+	if (found.size() < 2) {
+		return false;
+	}
+	std::sort(found.begin(), found.end());
+
+	frames.clear();
+	index = 0;
+	for (auto& entry : found) {
+		if (fs::path(entry.second).filename() == path.filename()) {
+			index = (int)frames.size();
+		}
+		frames.push_back(std::move(entry.second));
+	}
+	return true;
+}
+
+// Turns a list entry into a player over its numbered siblings, or over the frames of an
+// array stack, starting at the entry's frame.
+bool open_sequence(ImageState& state, std::string& errorOut) {
+	auto player = std::make_shared<SequencePlayer>();
+	int index = 0;
+	if (is_array_ext(to_lower(fs::path(array_file_path(state.currentPath)).extension().string()))) {
+		if (!find_array_frames(state.currentPath, player->frames, index)) {
+			errorOut = state.filename + " is not a stack of images";
+			return false;
+		}
+	}
+	else if (!find_sequence_frames(fs::path(state.currentPath), player->frames, index)) {
+		errorOut = "No numbered frames found next to " + state.filename;
+		return false;
+	}
+	player->frameCount = (int)player->frames.size();
+	player->current = index;
+	player->requested = index;
+	player->anchorFrame = index;
+	player->ring.resize(std::min<size_t>(kSequenceRingFrames, player->frames.size()));
+	state.sequence = std::move(player);
+	return true;
+}
+
+static int wrap_frame(const SequencePlayer& player, int frame) {
+	const int count = std::max(1, player.frameCount);
+	return ((frame % count) + count) % count;
+}
+
+// Stepping and scrubbing pause playback; the frame is shown as soon as it is decoded.
+void seek_sequence(ImageState& state, int frame) {
+	if (!state.sequence) {
+		return;
+	}
+	SequencePlayer& player = *state.sequence;
+	player.playing = false;
+	player.requested = player.loop ? wrap_frame(player, frame) : std::clamp(frame, 0, std::max(0, player.frameCount - 1));
+}
+
+void set_sequence_playing(ImageState& state, bool playing, double now) {
+	if (!state.sequence) {
+		return;
+	}
+	SequencePlayer& player = *state.sequence;
+	const bool atEnd = !player.loop && player.current == player.frameCount - 1;
+	player.playing = playing;
+	player.anchorTime = now;
+	player.anchorFrame = (playing && atEnd) ? 0 : player.current;
+	player.requested = player.anchorFrame;
+	if (playing) {
+		player.droppedFrames = 0;
+	}
+}
+
+// GL thread: a ring decode finished. Results for slots that were reassigned in the meantime
+// are dropped by the serial check.
+void store_sequence_frame(ImageState& state, DecodeResult& result) {
+	if (!state.sequence) {
+		return;
+	}
+	SequencePlayer& player = *state.sequence;
+	player.inFlight = std::max(0, player.inFlight - 1);
+	for (SequenceSlot& slot : player.ring) {
+		if (slot.serial == result.serial && slot.frame == result.sequenceFrame) {
+			slot.result = std::move(result);
+			slot.ready = true;
+			return;
+		}
+	}
+}
+
+void release_sequence_frames(SequencePlayer& player) {
+	for (SequenceSlot& slot : player.ring) {
+		slot = SequenceSlot();
+	}
+}
+
+static SequenceSlot* find_ready_slot(SequencePlayer& player, int frame) {
+	for (SequenceSlot& slot : player.ring) {
+		if (slot.ready && slot.frame == frame) {
+			return &slot;
+		}
+	}
+	return nullptr;
+}
+
+// Puts a decoded frame on screen without touching the entry's zoom and pan.
+static void show_sequence_frame(ImageStates& states, ImageState& state, SequencePlayer& player, SequenceSlot& slot) {
+	player.current = slot.frame;
+	slot.lastShown = ++player.shown;
+	if (!player.video) {
+		state.currentPath = player.frames[slot.frame];
+		if (!player.pages) {
+			state.filename = fs::path(state.currentPath).filename().u8string();
+		}
+	}
+	// A full-resolution decode still in flight belongs to the previous frame.
+	state.decodeSerial++;
+	state.fullResPending = false;
+	if (!slot.result.ok) {
+		std::fprintf(stderr, "Sequence frame %d failed: %s\n", slot.frame, slot.result.error.c_str());
+		return;
+	}
+
+	const float zoom = state.zoom;
+	const ImVec2 pan = state.pan;
+	// The slot keeps its pixels (Mats are shared, not copied) so stepping back is instant.
+	DecodeResult result = slot.result;
+	std::string applyError;
+	if (!apply_decoded_image(state, result, applyError)) {
+		std::fprintf(stderr, "Sequence frame %d failed: %s\n", slot.frame, applyError.c_str());
+		return;
+	}
+	state.loadStatus = LoadStatus::Ready;
+	activate_watch(states.watcher, array_file_path(state.normalizedPath));
+	state.zoom = zoom;
+	state.pan = pan;
+}
+
+// Keeps the ring holding the frames from `start` onwards, nearest first; a page stack only
+// wants the pages either side of `start`. Slots outside that window are reused least
+// recently shown first. At most one decode per worker is in flight, so scrubbing across
+// a long sequence never queues a backlog.
+static void fill_sequence_ring(ImageStates& states, ImageState& state, SequencePlayer& player, int start) {
+	const PreviewOptions options = desired_preview_options(states);
+	const int count = player.frameCount;
+	std::vector<int> wanted;
+	if (player.pages) {
+		for (int frame : { start, start + 1, start - 1 }) {
+			if (frame >= 0 && frame < count && (int)wanted.size() < (int)player.ring.size()) {
+				wanted.push_back(frame);
+			}
+		}
+	}
+	for (int k = 0; !player.pages && k < (int)player.ring.size(); ++k) {
+		if (start + k >= count && !player.loop) {
+			break;
+		}
+		wanted.push_back(wrap_frame(player, start + k));
+	}
+
+	const int maxInFlight = std::max(1, (int)states.decoder.pool.threads.size());
+	for (size_t k = 0; k < wanted.size() && player.inFlight < maxInFlight; ++k) {
+		const int frame = wanted[k];
+		auto held = std::find_if(player.ring.begin(), player.ring.end(), [frame](const SequenceSlot& slot) { return slot.frame == frame; });
+		if (held != player.ring.end() && (!held->ready || held->result.options == options)) {
+			continue; // decoded with the current toggles, or on its way
+		}
+		if (held == player.ring.end()) {
+			// Never-used slots have lastShown 0 and go first.
+			for (auto it = player.ring.begin(); it != player.ring.end(); ++it) {
+				if (std::find(wanted.begin(), wanted.end(), it->frame) == wanted.end()
+					&& (held == player.ring.end() || it->lastShown < held->lastShown)) {
+					held = it;
+				}
+			}
+			if (held == player.ring.end()) {
+				return;
+			}
+		}
+
+		SequenceSlot& slot = *held;
+		slot.frame = frame;
+		slot.ready = false;
+		slot.lastShown = 0;
+		slot.result = DecodeResult();
+		slot.serial = ++player.nextSerial;
+		player.inFlight++;
+
+		DecodePipeline* decoder = &states.decoder;
+		const std::uint64_t uid = state.uid;
+		const std::uint64_t serial = slot.serial;
+		const std::string path = player.frames[frame];
+		const cv::Size proxyTarget = states.canvasSize;
+		submit_job(decoder->pool, [decoder, uid, serial, frame, path, options, proxyTarget]() {
+			DecodeResult result;
+			result.uid = uid;
+			result.serial = serial;
+			result.sequenceFrame = frame;
+			result.options = options;
+			result.ok = decode_image_file(path, options, result, proxyTarget);
+			{
+				std::lock_guard<std::mutex> lock(decoder->resultMutex);
+				decoder->results.push_back(std::move(result));
+			}
+			request_redraw();
+		}, k == 0);
+	}
+}
+
+// Video players: takes over what the decoder thread produced, then points it at `target`.
+// Frames behind the stream position are gone from the stream, so a target there, or far
+// ahead of it, costs a seek; anything else is reached by reading on.
+static void update_video_ring(ImageStates& states, SequencePlayer& player, int target) {
+	VideoDecoder& video = *player.video;
+	std::deque<DecodeResult> arrived;
+	{
+		std::lock_guard<std::mutex> lock(video.mutex);
+		arrived.swap(video.frames);
+	}
+	for (DecodeResult& result : arrived) {
+		// The same frame again, else a free slot, else the frame farthest from the play head.
+		const int frame = result.sequenceFrame;
+		auto slot = std::find_if(player.ring.begin(), player.ring.end(), [frame](const SequenceSlot& s) { return s.frame == frame; });
+		if (slot == player.ring.end()) {
+			slot = std::find_if(player.ring.begin(), player.ring.end(), [](const SequenceSlot& s) { return s.frame < 0; });
+		}
+		if (slot == player.ring.end()) {
+			slot = std::max_element(player.ring.begin(), player.ring.end(), [target](const SequenceSlot& a, const SequenceSlot& b) {
+				return std::abs(a.frame - target) < std::abs(b.frame - target);
+			});
+		}
+		slot->frame = frame;
+		slot->result = std::move(result);
+		slot->ready = true;
+	}
+
+	const int back = (int)player.ring.size() / 4;
+	const int ahead = std::min(kSequenceRingFrames, (int)player.ring.size() / 2);
+	{
+		std::lock_guard<std::mutex> lock(video.mutex);
+		video.options = desired_preview_options(states);
+		if (!find_ready_slot(player, target) && (target < video.position || target > video.position + kVideoSeekThreshold)) {
+			// Start a little early so stepping back from the target stays cached.
+			video.position = std::max(0, target - back);
+			video.generation++;
+		}
+		video.wantEnd = target + ahead + 1;
+	}
+	video.wake.notify_one();
+}
+
+// Picks up what the decoder thread learned about the file. The ring is sized from the
+// frame size so a 4K video does not hold as many frames as a VGA one.
+static bool sync_video_player(ImageStates& states, ImageState& state, SequencePlayer& player, std::string& errorOut) {
+	VideoDecoder& video = *player.video;
+	std::lock_guard<std::mutex> lock(video.mutex);
+	if (!video.error.empty()) {
+		errorOut = video.error;
+		return false;
+	}
+	if (!video.opened) {
+		return true;
+	}
+	if (player.ring.empty()) {
+		if (video.fps > 0.0) {
+			player.fps = (float)video.fps;
+		}
+		state.width = video.width;
+		state.height = video.height;
+		const std::uint64_t frameBytes = std::max<std::uint64_t>(1, (std::uint64_t)video.width * video.height * (3 + 6));
+		const std::uint64_t budget = (std::uint64_t)states.prefetchBudgetMB * 1024 * 1024 / 2;
+		player.ring.resize((size_t)std::clamp<std::uint64_t>(budget / frameBytes, 4, kVideoCacheFrames));
+	}
+	player.frameCount = video.frameCount;
+	player.current = std::min(player.current, player.frameCount - 1);
+	player.requested = std::min(player.requested, player.frameCount - 1);
+	return true;
+}
+
+// Called once per frame. Only the selected entry plays. While playing, the frame due by the
+// clock is shown if decoded; otherwise the newest decoded frame before it, and the frames
+// passed over are counted as dropped.
+void update_sequence_playback(ImageStates& states, double now) {
+	std::vector<std::pair<std::uint64_t, std::string>> failed;
+	for (int i = 0; i < (int)states.states.size(); ++i) {
+		ImageState& state = states.states[i];
+		if (!state.sequence) {
+			continue;
+		}
+		SequencePlayer& player = *state.sequence;
+		if (player.video) {
+			std::string videoError;
+			if (!sync_video_player(states, state, player, videoError)) {
+				failed.emplace_back(state.uid, videoError);
+				continue;
+			}
+			if (player.frameCount == 0) {
+				continue; // still opening
+			}
+		}
+		if (i != states.selected) {
+			player.playing = false;
+			// A video in the list still needs its first frame for the thumbnail; once it has
+			// one, an entry the prefetcher unloaded stays unloaded.
+			if (!player.video || !state.previewRGBA.empty() || !state.thumbRGBA.empty()) {
+				continue;
+			}
+		}
+
+		const int count = player.frameCount;
+		int target = player.requested;
+		if (player.playing) {
+			const long long elapsed = std::max(0LL, (long long)std::floor((now - player.anchorTime) * player.fps));
+			long long due = player.anchorFrame + elapsed;
+			if (!player.loop) {
+				due = std::min<long long>(due, count - 1);
+			}
+			target = (int)(due % count);
+		}
+
+		if (target != player.current || state.previewRGBA.empty()) {
+			if (player.playing) {
+				const int distance = wrap_frame(player, target - player.current);
+				for (int k = distance; k >= 1; --k) {
+					if (SequenceSlot* slot = find_ready_slot(player, wrap_frame(player, player.current + k))) {
+						player.droppedFrames += k - 1;
+						show_sequence_frame(states, state, player, *slot);
+						break;
+					}
+				}
+				player.requested = player.current;
+			}
+			else if (SequenceSlot* slot = find_ready_slot(player, target)) {
+				show_sequence_frame(states, state, player, *slot);
+			}
+		}
+
+		if (player.playing) {
+			if (!player.loop && player.current == count - 1) {
+				player.playing = false;
+			}
+			else {
+				states.animating = true;
+			}
+		}
+		if (player.video) {
+			update_video_ring(states, player, target);
+		}
+		else {
+			fill_sequence_ring(states, state, player, target);
+		}
+	}
+
+	for (const auto& failure : failed) {
+		for (int i = 0; i < (int)states.states.size(); ++i) {
+			if (states.states[i].uid == failure.first) {
+				remove_image_at(states, i);
+				showError(failure.second.c_str());
+				break;
+			}
+		}
+	}
+}
+
+// Transport bar along the bottom of the canvas.
+void draw_sequence_hud(ImageState& state, ImVec2 origin, ImVec2 avail, double now) {
+	if (!state.sequence) {
+		return;
+	}
+	SequencePlayer& player = *state.sequence;
+	const int count = player.frameCount;
+	if (count == 0) {
+		return;
+	}
+	const float height = ImGui::GetFrameHeightWithSpacing() * 2.0f + ImGui::GetStyle().WindowPadding.y * 2.0f;
+
+	ImGui::SetCursorScreenPos(ImVec2(origin.x, origin.y + avail.y - height));
+	ImGui::PushStyleColor(ImGuiCol_ChildBg, ImVec4(0.10f, 0.10f, 0.10f, 0.75f));
+	ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 1.0f, 1.0f, 1.00f));
+	// A child window, so dragging the scrubber does not also pan the canvas underneath.
+	ImGui::BeginChild("##sequence_hud", ImVec2(avail.x, height), ImGuiChildFlags_AlwaysUseWindowPadding, ImGuiWindowFlags_NoScrollbar);
+
+	if (ImGui::Button(player.playing ? "Pause" : "Play", ImVec2(60.0f, 0.0f))) {
+		set_sequence_playing(state, !player.playing, now);
+	}
+	ImGui::SameLine();
+	if (ImGui::ArrowButton("##prev", ImGuiDir_Left)) {
+		seek_sequence(state, player.current - 1);
+	}
+	ImGui::SameLine();
+	if (ImGui::ArrowButton("##next", ImGuiDir_Right)) {
+		seek_sequence(state, player.current + 1);
+	}
+	ImGui::SameLine();
+	int frameNumber = (player.playing ? player.current : player.requested) + 1;
+	ImGui::SetNextItemWidth(-1.0f);
+	if (ImGui::SliderInt("##frame", &frameNumber, 1, count)) {
+		seek_sequence(state, frameNumber - 1);
+	}
+
+	ImGui::SetNextItemWidth(80.0f);
+	if (ImGui::DragFloat("FPS", &player.fps, 0.25f, 1.0f, 240.0f, "%.1f", ImGuiSliderFlags_AlwaysClamp)) {
+		player.anchorTime = now;
+		player.anchorFrame = player.current;
+	}
+	ImGui::SameLine();
+	ImGui::Checkbox("Loop", &player.loop);
+	ImGui::SameLine();
+	const int buffered = (int)std::count_if(player.ring.begin(), player.ring.end(), [](const SequenceSlot& slot) { return slot.ready; });
+	ImGui::Text("%s %d / %d   buffered %d/%d   dropped %llu", player.pages ? "Page" : "Frame", player.current + 1, count,
+		buffered, (int)player.ring.size(), (unsigned long long)player.droppedFrames);
+
+	ImGui::EndChild();
+	ImGui::PopStyleColor(2);
+}
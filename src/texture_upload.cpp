@@ -0,0 +1,106 @@
+#include "ImagePixelViewer.h"
+
+// Uploads go through a small ring of pixel buffer objects: the CPU copy lands in
+// driver-owned memory and glTexSubImage2D returns without waiting for the transfer,
+// so a file rewritten at video rate does not stall the render thread.
+static const int kUploadRingSize = 3;
+
+struct PixelUploadRing {
+	std::array<GLuint, kUploadRingSize> buffers{};
+	int next = 0;
+};
+
+static PixelUploadRing g_uploadRing;
+
+bool texture_format_for(int matType, GLint& internalFormat, GLenum& dataType) {
+	switch (matType) {
+	case CV_8UC4:
+		internalFormat = GL_RGBA8;
+		dataType = GL_UNSIGNED_BYTE;
+		return true;
+	case CV_16UC4:
+		internalFormat = GL_RGBA16;
+		dataType = GL_UNSIGNED_SHORT;
+		return true;
+	case CV_32FC4:
+		internalFormat = GL_RGBA32F;
+		dataType = GL_FLOAT;
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Clears the GL error queue, so the next glGetError reports only what follows.
+static void drain_gl_errors() {
+	while (glGetError() != GL_NO_ERROR) {
+	}
+}
+
+// Writes `rgba` into the already allocated `texture` at (dstX, dstY).
+bool upload_texture_pixels(const ImageTexture& texture, const cv::Mat& rgba, int dstX, int dstY, std::string& error) {
+	GLint internalFormat = 0;
+	GLenum dataType = 0;
+	if (texture.id == 0 || rgba.empty() || !texture_format_for(rgba.type(), internalFormat, dataType)) {
+		error = "Invalid texture upload.";
+		return false;
+	}
+
+	if (g_uploadRing.buffers[0] == 0) {
+		glGenBuffers(kUploadRingSize, g_uploadRing.buffers.data());
+	}
+	const GLuint pbo = g_uploadRing.buffers[g_uploadRing.next];
+	g_uploadRing.next = (g_uploadRing.next + 1) % kUploadRingSize;
+
+	const size_t rowBytes = (size_t)rgba.cols * rgba.elemSize();
+	const GLsizeiptr totalBytes = (GLsizeiptr)(rowBytes * (size_t)rgba.rows);
+
+	drain_gl_errors();
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+	// Orphan the previous contents: if the GPU is still reading them the driver hands out fresh storage.
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, totalBytes, nullptr, GL_STREAM_DRAW);
+	void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, totalBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+	glBindTexture(GL_TEXTURE_2D, texture.id);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if (mapped != nullptr) {
+		if (rgba.isContinuous()) {
+			std::memcpy(mapped, rgba.data, (size_t)totalBytes);
+		}
+		else {
+			auto* dst = static_cast<unsigned char*>(mapped);
+			for (int y = 0; y < rgba.rows; ++y) {
+				std::memcpy(dst + (size_t)y * rowBytes, rgba.ptr(y), rowBytes);
+			}
+		}
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, dstX, dstY, rgba.cols, rgba.rows, GL_RGBA, dataType, nullptr);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	else {
+		// Mapping failed (out of memory, old driver): plain client-memory upload. The errors
+		// the orphaning or the map raised are not this upload's.
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		drain_gl_errors();
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)(rgba.step[0] / rgba.elemSize()));
+		glTexSubImage2D(GL_TEXTURE_2D, 0, dstX, dstY, rgba.cols, rgba.rows, GL_RGBA, dataType, rgba.data);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (GLenum glError = glGetError(); glError != GL_NO_ERROR) {
+		std::ostringstream oss;
+		oss << "OpenGL error during texture upload: 0x" << std::hex << glError;
+		error = oss.str();
+		return false;
+	}
+	return true;
+}
+
+void release_upload_ring() {
+	if (g_uploadRing.buffers[0] != 0) {
+		glDeleteBuffers(kUploadRingSize, g_uploadRing.buffers.data());
+		g_uploadRing.buffers.fill(0);
+	}
+	g_uploadRing.next = 0;
+}
@@ -0,0 +1,71 @@
+#include "ImagePixelViewer.h"
+
+static int slots_per_row(const ThumbnailAtlas& atlas) {
+	return std::max(1, atlas.pageSize / (int)thumbWidth);
+}
+
+static int slots_per_page(const ThumbnailAtlas& atlas) {
+	return slots_per_row(atlas) * std::max(1, atlas.pageSize / (int)thumbHeight);
+}
+
+// Reuses a freed slot first; opens a new page only when every page is full.
+bool acquire_thumb_slot(ThumbnailAtlas& atlas, int& slot, std::string& error) {
+	if (!atlas.freeSlots.empty()) {
+		slot = atlas.freeSlots.back();
+		atlas.freeSlots.pop_back();
+		return true;
+	}
+	const int page = atlas.nextSlot / slots_per_page(atlas);
+	if (page >= (int)atlas.pages.size()) {
+		ImageTexture texture{};
+		if (!allocate_texture(texture, atlas.pageSize, atlas.pageSize, GL_RGBA8, GL_UNSIGNED_BYTE, error)) {
+			return false;
+		}
+		atlas.pages.push_back(texture);
+	}
+	slot = atlas.nextSlot++;
+	return true;
+}
+
+void release_thumb_slot(ThumbnailAtlas& atlas, int& slot) {
+	if (slot >= 0) {
+		atlas.freeSlots.push_back(slot);
+		slot = -1;
+	}
+}
+
+static void slot_origin(const ThumbnailAtlas& atlas, int slot, int& page, int& x, int& y) {
+	const int perPage = slots_per_page(atlas);
+	const int local = slot % perPage;
+	page = slot / perPage;
+	x = (local % slots_per_row(atlas)) * (int)thumbWidth;
+	y = (local / slots_per_row(atlas)) * (int)thumbHeight;
+}
+
+bool upload_thumb_slot(ThumbnailAtlas& atlas, int slot, const cv::Mat& rgba, std::string& error) {
+	if (rgba.type() != CV_8UC4 || rgba.cols != (int)thumbWidth || rgba.rows != (int)thumbHeight) {
+		error = "Thumbnail must be a thumbWidth x thumbHeight CV_8UC4 image.";
+		return false;
+	}
+	int page = 0, x = 0, y = 0;
+	slot_origin(atlas, slot, page, x, y);
+	return upload_texture_pixels(atlas.pages[page], rgba, x, y, error);
+}
+
+ImTextureID thumb_slot_texture(const ThumbnailAtlas& atlas, int slot, ImVec2& uv0, ImVec2& uv1) {
+	int page = 0, x = 0, y = 0;
+	slot_origin(atlas, slot, page, x, y);
+	const float size = (float)atlas.pageSize;
+	uv0 = ImVec2((float)x / size, (float)y / size);
+	uv1 = ImVec2((float)(x + (int)thumbWidth) / size, (float)(y + (int)thumbHeight) / size);
+	return (ImTextureID)(uintptr_t)atlas.pages[page].id;
+}
+
+void release_thumbnail_atlas(ThumbnailAtlas& atlas) {
+	for (auto& page : atlas.pages) {
+		release_texture(page);
+	}
+	atlas.pages.clear();
+	atlas.freeSlots.clear();
+	atlas.nextSlot = 0;
+}
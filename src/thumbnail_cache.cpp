@@ -0,0 +1,228 @@
+#include "ImagePixelViewer.h"
+
+#include <algorithm>
+#include <fstream>
+
+// On-disk cache of list thumbnails and basic metadata, so reopening a dataset fills the
+// list without decoding. There is one entry per normalized path, which also stores the
+// write time + size and the PreviewOptions it was rendered with; a modified file or a
+// different display setting misses, and the next decode replaces the entry. prune_thumbnail_cache drops entries unused for a while.
+
+static const char kThumbCacheMagic[4] = { 'I', 'P', 'V', 'T' };
+static const std::uint32_t kThumbCacheVersion = 2;
+static const std::uintmax_t kThumbCacheMaxBytes = 256ull << 20;
+static const auto kThumbCacheMaxAge = std::chrono::hours(24 * 30);
+
+static fs::path thumbnail_cache_dir() {
+	static const fs::path dir = [] {
+		fs::path base;
+#ifdef _WIN32
+		if (const char* local = std::getenv("LOCALAPPDATA")) base = fs::u8path(local);
+#else
+		if (const char* xdg = std::getenv("XDG_CACHE_HOME")) base = fs::u8path(xdg);
+		else if (const char* home = std::getenv("HOME")) base = fs::u8path(home) / ".cache";
+#endif
+		if (base.empty()) {
+			std::error_code ec;
+			base = fs::temp_directory_path(ec);
+			if (ec) {
+				return fs::path();
+			}
+		}
+		fs::path result = base / "ImagePixelViewer" / "thumbs";
+		std::error_code ec;
+		fs::create_directories(result, ec);
+		return ec ? fs::path() : result;
+	}();
+	return dir;
+}
+
+static std::int64_t write_time_ticks(fs::file_time_type writeTime) {
+	return (std::int64_t)writeTime.time_since_epoch().count();
+}
+
+static fs::path thumbnail_cache_file(const std::string& normalizedPath) {
+	const fs::path dir = thumbnail_cache_dir();
+	if (dir.empty()) {
+		return fs::path();
+	}
+	// FNV-1a over the path only, so a newer stamp overwrites the older entry.
+	std::uint64_t hash = 1469598103934665603ull;
+	auto mix = [&hash](const void* data, size_t size) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; ++i) {
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+	};
+	mix(normalizedPath.data(), normalizedPath.size());
+
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.thumb", (unsigned long long)hash);
+	return dir / name;
+}
+
+static std::uint8_t options_bits(const PreviewOptions& options) {
+	return (std::uint8_t)((options.gray ? 1 : 0) | (options.autoContrast ? 2 : 0) | (options.pseudoColor ? 4 : 0)
+		| (options.ignoreAlpha ? 8 : 0) | (options.pyramidKeepExtremes ? 16 : 0));
+}
+
+template <typename T> static void write_pod(std::ostream& out, const T& value) {
+	out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+template <typename T> static bool read_pod(std::istream& in, T& value) {
+	return (bool)in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+static void write_string(std::ostream& out, const std::string& value) {
+	write_pod(out, (std::uint32_t)value.size());
+	out.write(value.data(), (std::streamsize)value.size());
+}
+static bool read_string(std::istream& in, std::string& value) {
+	std::uint32_t length = 0;
+	if (!read_pod(in, length) || length > 64 * 1024) {
+		return false;
+	}
+	value.resize(length);
+	return (bool)in.read(&value[0], length);
+}
+
+bool read_thumbnail_cache(const std::string& normalizedPath, fs::file_time_type writeTime, std::uintmax_t fileSize, const PreviewOptions& options, ThumbnailCacheEntry& entry) {
+	const fs::path file = thumbnail_cache_file(normalizedPath);
+	if (file.empty()) {
+		return false;
+	}
+	std::ifstream in(file, std::ios::binary);
+	if (!in) {
+		return false;
+	}
+
+	char magic[4];
+	std::uint32_t version = 0;
+	std::int64_t ticks = 0;
+	std::uint64_t size = 0;
+	std::uint8_t bits = 0;
+	std::string path;
+	if (!in.read(magic, 4) || std::memcmp(magic, kThumbCacheMagic, 4) != 0
+		|| !read_pod(in, version) || version != kThumbCacheVersion
+		|| !read_pod(in, ticks) || !read_pod(in, size) || !read_pod(in, bits) || !read_string(in, path)) {
+		return false;
+	}
+	// The hash only picks the file; the stored key must match exactly.
+	if (ticks != write_time_ticks(writeTime) || size != (std::uint64_t)fileSize || bits != options_bits(options)
+		|| path != normalizedPath) {
+		return false;
+	}
+
+	std::int32_t thumbW = 0, thumbH = 0;
+	if (!read_pod(in, entry.width) || !read_pod(in, entry.height) || !read_pod(in, entry.channels)
+		|| !read_string(in, entry.depth) || !read_pod(in, thumbW) || !read_pod(in, thumbH)
+		|| thumbW != (int)thumbWidth || thumbH != (int)thumbHeight) {
+		return false;
+	}
+	entry.thumbRGBA.create(thumbH, thumbW, CV_8UC4);
+	if (!in.read(reinterpret_cast<char*>(entry.thumbRGBA.data), (std::streamsize)entry.thumbRGBA.total() * 4)) {
+		return false;
+	}
+	// The entry's own write time is its last use, which is what pruning goes by.
+	in.close();
+	std::error_code ec;
+	fs::last_write_time(file, fs::file_time_type::clock::now(), ec);
+	return true;
+}
+
+// Best effort: a cache that cannot be written only costs a decode next time.
+void write_thumbnail_cache(const std::string& normalizedPath, fs::file_time_type writeTime, std::uintmax_t fileSize, const PreviewOptions& options, const ThumbnailCacheEntry& entry) {
+	if (entry.thumbRGBA.type() != CV_8UC4 || entry.thumbRGBA.cols != (int)thumbWidth || entry.thumbRGBA.rows != (int)thumbHeight) {
+		return;
+	}
+	const fs::path file = thumbnail_cache_file(normalizedPath);
+	if (file.empty()) {
+		return;
+	}
+	// Write aside and rename, so a concurrent reader never sees a half-written entry.
+	std::ostringstream suffix;
+	suffix << ".tmp" << std::this_thread::get_id();
+	fs::path temp = file;
+	temp += suffix.str();
+	{
+		std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+		if (!out) {
+			return;
+		}
+		out.write(kThumbCacheMagic, 4);
+		write_pod(out, kThumbCacheVersion);
+		write_pod(out, write_time_ticks(writeTime));
+		write_pod(out, (std::uint64_t)fileSize);
+		write_pod(out, options_bits(options));
+		write_string(out, normalizedPath);
+		write_pod(out, entry.width);
+		write_pod(out, entry.height);
+		write_pod(out, entry.channels);
+		write_string(out, entry.depth);
+		write_pod(out, (std::int32_t)entry.thumbRGBA.cols);
+		write_pod(out, (std::int32_t)entry.thumbRGBA.rows);
+		const cv::Mat pixels = entry.thumbRGBA.isContinuous() ? entry.thumbRGBA : entry.thumbRGBA.clone();
+		out.write(reinterpret_cast<const char*>(pixels.data), (std::streamsize)pixels.total() * 4);
+		if (!out) {
+			out.close();
+			std::error_code ec;
+			fs::remove(temp, ec);
+			return;
+		}
+	}
+	std::error_code ec;
+	fs::rename(temp, file, ec);
+	if (ec) {
+		fs::remove(temp, ec);
+	}
+}
+
+// Removes entries unused for kThumbCacheMaxAge, then the least recently used ones until the
+// cache fits in kThumbCacheMaxBytes. Leftover temporaries of an interrupted write go too.
+void prune_thumbnail_cache() {
+	const fs::path dir = thumbnail_cache_dir();
+	if (dir.empty()) {
+		return;
+	}
+	struct CacheFile {
+		fs::path path;
+		fs::file_time_type used;
+		std::uintmax_t size;
+	};
+	std::vector<CacheFile> files;
+	std::uintmax_t total = 0;
+	const auto now = fs::file_time_type::clock::now();
+	std::error_code ec;
+	for (fs::directory_iterator it(dir, ec); !ec && it != fs::directory_iterator(); it.increment(ec)) {
+		std::error_code entryError;
+		const fs::file_time_type used = it->last_write_time(entryError);
+		const std::uintmax_t size = entryError ? 0 : it->file_size(entryError);
+		if (entryError) {
+			continue;
+		}
+		if (it->path().extension() != ".thumb") {
+			if (now - used > std::chrono::hours(1)) {
+				fs::remove(it->path(), entryError);
+			}
+			continue;
+		}
+		if (now - used > kThumbCacheMaxAge) {
+			fs::remove(it->path(), entryError);
+			continue;
+		}
+		files.push_back({ it->path(), used, size });
+		total += size;
+	}
+	if (total <= kThumbCacheMaxBytes) {
+		return;
+	}
+	std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b) { return a.used < b.used; });
+	for (const CacheFile& file : files) {
+		if (total <= kThumbCacheMaxBytes) {
+			break;
+		}
+		std::error_code removeError;
+		if (fs::remove(file.path, removeError)) {
+			total -= file.size;
+		}
+	}
+}
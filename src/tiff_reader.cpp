@@ -0,0 +1,365 @@
+#include "ImagePixelViewer.h"
+
+#include <tiffio.h>
+
+// Strips and tiles of a TIFF are compressed independently, so they can be inflated on all
+// cores at once. A libtiff handle is not thread-safe; every parallel stripe opens its own
+// over one shared mapping of the file, which costs only a directory parse.
+
+struct TiffLayout {
+	int width = 0;
+	int height = 0;
+	int samples = 1;
+	int depth = CV_8U;
+	bool separate = false; // PLANARCONFIG_SEPARATE: one set of chunks per sample
+	bool rgb = false;      // stored RGB(A), returned as BGR(A) like imread
+	bool tiled = false;
+	bool scanlines = false; // strips too large to buffer whole are read a row at a time
+	int chunkWidth = 0;
+	int chunkHeight = 0;
+	int chunksAcross = 0;
+	int chunksDown = 0;
+	size_t chunkBytes = 0; // decode buffer: one chunk, or one row when reading scanlines
+};
+
+// Read cursor of one handle over the shared mapping.
+struct TiffCursor {
+	const MappedFile* file = nullptr;
+	std::uint64_t pos = 0;
+};
+
+static tmsize_t tiff_read(thandle_t handle, void* buffer, tmsize_t size) {
+	TiffCursor& cursor = *static_cast<TiffCursor*>(handle);
+	if (size <= 0 || cursor.pos >= cursor.file->size) {
+		return 0;
+	}
+	const size_t count = std::min((size_t)size, (size_t)(cursor.file->size - cursor.pos));
+	std::memcpy(buffer, cursor.file->data + cursor.pos, count);
+	cursor.pos += count;
+	return (tmsize_t)count;
+}
+
+static tmsize_t tiff_write(thandle_t, void*, tmsize_t) {
+	return 0;
+}
+
+static toff_t tiff_seek(thandle_t handle, toff_t offset, int whence) {
+	TiffCursor& cursor = *static_cast<TiffCursor*>(handle);
+	switch (whence) {
+	case SEEK_SET: cursor.pos = offset; break;
+	case SEEK_CUR: cursor.pos += offset; break;
+	case SEEK_END: cursor.pos = cursor.file->size + offset; break;
+	default: break;
+	}
+	return cursor.pos;
+}
+
+static int tiff_close(thandle_t) {
+	return 0;
+}
+
+static toff_t tiff_size(thandle_t handle) {
+	return static_cast<TiffCursor*>(handle)->file->size;
+}
+
+// Hands libtiff the mapping itself, so strips are decompressed straight out of it.
+static int tiff_map(thandle_t handle, void** base, toff_t* size) {
+	const MappedFile& file = *static_cast<TiffCursor*>(handle)->file;
+	*base = (void*)file.data;
+	*size = file.size;
+	return 1;
+}
+
+static void tiff_unmap(thandle_t, void*, toff_t) {
+}
+
+// libtiff's handlers are process-wide: set once at startup, before any worker decodes.
+// Warnings about unknown or private tags are noise for a viewer.
+void init_tiff_reader() {
+	TIFFSetWarningHandler(nullptr);
+}
+
+static TIFF* open_tiff(TiffCursor& cursor, const std::string& path, int page) {
+	TIFF* tiff = TIFFClientOpen(path.c_str(), "r", &cursor, tiff_read, tiff_write, tiff_seek, tiff_close, tiff_size, tiff_map, tiff_unmap);
+	if (tiff != nullptr && page > 0 && !TIFFSetDirectory(tiff, (tdir_t)page)) {
+		TIFFClose(tiff);
+		return nullptr;
+	}
+	return tiff;
+}
+
+// Largest strip or tile decoded into a buffer of its own. A file written as one huge strip
+// would otherwise allocate a second copy of the whole page, even for a proxy or a hover
+// tile; its strips are read by scanline instead. Tiles that large are left to OpenCV.
+static const size_t kMaxTiffChunkBytes = 64u << 20;
+
+// Layouts imread(IMREAD_UNCHANGED) would return as they are stored: gray, RGB and RGBA at
+// whole-byte depths. Palette, YCbCr, CMYK and 1-12 bit data are left to OpenCV.
+static bool read_tiff_layout(TIFF* tiff, TiffLayout& layout) {
+	std::uint32_t width = 0, height = 0;
+	std::uint16_t photometric = 0;
+	if (!TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &width) || !TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &height)
+		|| !TIFFGetField(tiff, TIFFTAG_PHOTOMETRIC, &photometric)) {
+		return false;
+	}
+	std::uint16_t bits = 1, samples = 1, sampleFormat = SAMPLEFORMAT_UINT, planar = PLANARCONFIG_CONTIG;
+	TIFFGetFieldDefaulted(tiff, TIFFTAG_BITSPERSAMPLE, &bits);
+	TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLESPERPIXEL, &samples);
+	TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLEFORMAT, &sampleFormat);
+	TIFFGetFieldDefaulted(tiff, TIFFTAG_PLANARCONFIG, &planar);
+	if (width == 0 || height == 0 || width > (std::uint32_t)std::numeric_limits<int>::max() || height > (std::uint32_t)std::numeric_limits<int>::max()) {
+		return false;
+	}
+	if (photometric == PHOTOMETRIC_MINISBLACK && samples == 1) {
+		layout.rgb = false;
+	}
+	else if (photometric == PHOTOMETRIC_RGB && (samples == 3 || samples == 4)) {
+		layout.rgb = true;
+	}
+	else {
+		return false;
+	}
+	// The same depths probe_tiff reports, so the size estimate matches what is allocated.
+	if (bits == 8 && sampleFormat == SAMPLEFORMAT_UINT) layout.depth = CV_8U;
+	else if (bits == 16 && sampleFormat == SAMPLEFORMAT_UINT) layout.depth = CV_16U;
+	else if (bits == 16 && sampleFormat == SAMPLEFORMAT_INT) layout.depth = CV_16S;
+	else if (bits == 32 && sampleFormat == SAMPLEFORMAT_INT) layout.depth = CV_32S;
+	else if (bits == 32 && sampleFormat == SAMPLEFORMAT_IEEEFP) layout.depth = CV_32F;
+	else if (bits == 64 && sampleFormat == SAMPLEFORMAT_IEEEFP) layout.depth = CV_64F;
+	else return false;
+
+	layout.width = (int)width;
+	layout.height = (int)height;
+	layout.samples = samples;
+	layout.separate = planar == PLANARCONFIG_SEPARATE && samples > 1;
+	layout.tiled = TIFFIsTiled(tiff) != 0;
+	std::uint32_t chunkWidth = width, chunkHeight = height;
+	if (layout.tiled) {
+		if (!TIFFGetField(tiff, TIFFTAG_TILEWIDTH, &chunkWidth) || !TIFFGetField(tiff, TIFFTAG_TILELENGTH, &chunkHeight)) {
+			return false;
+		}
+		layout.chunkBytes = (size_t)std::max<tmsize_t>(0, TIFFTileSize(tiff));
+	}
+	else {
+		std::uint32_t rowsPerStrip = height;
+		TIFFGetFieldDefaulted(tiff, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip);
+		chunkHeight = std::min(rowsPerStrip, height);
+		layout.chunkBytes = (size_t)std::max<tmsize_t>(0, TIFFStripSize(tiff));
+	}
+	if (chunkWidth == 0 || chunkHeight == 0 || layout.chunkBytes == 0) {
+		return false;
+	}
+	if (layout.chunkBytes > kMaxTiffChunkBytes) {
+		if (layout.tiled) {
+			return false;
+		}
+		layout.scanlines = true;
+		layout.chunkBytes = (size_t)std::max<tmsize_t>(0, TIFFScanlineSize(tiff));
+		if (layout.chunkBytes == 0) {
+			return false;
+		}
+	}
+	layout.chunkWidth = (int)std::min<std::uint32_t>(chunkWidth, std::numeric_limits<int>::max());
+	layout.chunkHeight = (int)chunkHeight;
+	layout.chunksAcross = (int)((width + chunkWidth - 1) / chunkWidth);
+	layout.chunksDown = (int)((height + chunkHeight - 1) / chunkHeight);
+	const std::uint64_t expected = (std::uint64_t)layout.chunksAcross * layout.chunksDown * (layout.separate ? samples : 1);
+	return expected == (layout.tiled ? TIFFNumberOfTiles(tiff) : TIFFNumberOfStrips(tiff));
+}
+
+// One strip or tile to decode: its grid position and, for planar files, its sample.
+struct TiffChunk {
+	int across = 0;
+	int down = 0;
+	int plane = 0;
+};
+
+// Copies the pixels of decoded rows that fall on the output grid: region.tl() plus
+// multiples of `scale`. `buffer` holds `rows` rows of the chunk, starting at image row `y0`.
+static void copy_tiff_rows(const TiffLayout& layout, const TiffChunk& chunk, const unsigned char* buffer, int y0, int rows,
+	cv::Rect region, int scale, cv::Mat& out) {
+	const size_t elem = CV_ELEM_SIZE1(layout.depth);
+	const int chunkSamples = layout.separate ? 1 : layout.samples;
+	const size_t pixelBytes = elem * chunkSamples;
+	const size_t rowBytes = pixelBytes * layout.chunkWidth;
+	const int x0 = chunk.across * layout.chunkWidth;
+	const int x1 = std::min({ x0 + layout.chunkWidth, layout.width, region.x + region.width });
+	const int y1 = std::min({ y0 + rows, layout.height, region.y + region.height });
+	// First grid column and row inside the chunk.
+	const int xs = region.x + (std::max(x0, region.x) - region.x + scale - 1) / scale * scale;
+	const int ys = region.y + (std::max(y0, region.y) - region.y + scale - 1) / scale * scale;
+	if (xs >= x1 || ys >= y1) {
+		return;
+	}
+
+	// Destination channel of each stored sample; RGB(A) lands as BGR(A).
+	int channelOf[4] = { 0, 1, 2, 3 };
+	if (layout.rgb) {
+		channelOf[0] = 2;
+		channelOf[2] = 0;
+	}
+	const size_t outPixelBytes = elem * layout.samples;
+	const bool straightCopy = scale == 1 && !layout.separate && !layout.rgb;
+	for (int y = ys; y < y1; y += scale) {
+		const unsigned char* src = buffer + (size_t)(y - y0) * rowBytes + (size_t)(xs - x0) * pixelBytes;
+		unsigned char* dst = out.ptr((y - region.y) / scale) + (size_t)((xs - region.x) / scale) * outPixelBytes;
+		if (straightCopy) {
+			std::memcpy(dst, src, (size_t)(x1 - xs) * pixelBytes);
+			continue;
+		}
+		for (int x = xs; x < x1; x += scale, src += pixelBytes * scale, dst += outPixelBytes) {
+			for (int s = 0; s < chunkSamples; ++s) {
+				const int channel = channelOf[layout.separate ? chunk.plane : s];
+				std::memcpy(dst + channel * elem, src + s * elem, elem);
+			}
+		}
+	}
+}
+
+// Faults in the compressed bytes of one chunk, one read per page, so its I/O can be timed
+// apart from the decode.
+static void fault_in(const MappedFile& file, std::uint64_t offset, std::uint64_t count) {
+	volatile unsigned char sink = 0;
+	const std::uint64_t end = std::min<std::uint64_t>(offset + count, file.size);
+	for (std::uint64_t at = offset; at < end; at += 4096) {
+		sink ^= file.data[at];
+	}
+	if (offset < end) {
+		sink ^= file.data[end - 1];
+	}
+	(void)sink;
+}
+
+// Decodes `region` of page `page` (the whole page when empty) into `out`, keeping every
+// `scale`-th pixel in each direction. Only the strips or tiles overlapping the region are
+// read, pulled from a shared queue by one stripe per core so that slow-to-inflate chunks
+// even out. Each stripe faults in its own chunks, so the I/O is parallel too; `ioMs` is
+// the mapping plus the stripes' average time waiting on it. `wholeFile` asks the OS to
+// read ahead; a region read leaves paging on demand, and reads an oversized strip only up
+// to the region's last row.
+static bool decode_tiff(const std::string& path, int page, cv::Rect region, int scale, bool wholeFile, cv::Mat& out,
+	double& ioMs, double& decodeMs, std::string& errorOut) {
+	const auto start = std::chrono::steady_clock::now();
+	MappedFile file;
+	if (!map_file(path, file, errorOut, wholeFile ? MapAccess::Sequential : MapAccess::Random)) {
+		return false;
+	}
+	const auto mapped = std::chrono::steady_clock::now();
+
+	TiffLayout layout;
+	{
+		TiffCursor cursor{ &file };
+		TIFF* tiff = open_tiff(cursor, path, page);
+		const bool supported = tiff != nullptr && read_tiff_layout(tiff, layout);
+		if (tiff != nullptr) {
+			TIFFClose(tiff);
+		}
+		if (!supported) {
+			errorOut = "TIFF layout not handled by the parallel reader: " + path;
+			return false;
+		}
+	}
+	const cv::Rect bounds(0, 0, layout.width, layout.height);
+	region = region.empty() ? bounds : (region & bounds);
+	if (region.empty()) {
+		errorOut = "Region outside the image: " + path;
+		return false;
+	}
+	scale = std::max(1, scale);
+	out.create((region.height + scale - 1) / scale, (region.width + scale - 1) / scale, CV_MAKETYPE(layout.depth, layout.samples));
+
+	std::vector<TiffChunk> chunks;
+	const int planes = layout.separate ? layout.samples : 1;
+	for (int plane = 0; plane < planes; ++plane) {
+		for (int down = region.y / layout.chunkHeight; down <= (region.y + region.height - 1) / layout.chunkHeight; ++down) {
+			for (int across = region.x / layout.chunkWidth; across <= (region.x + region.width - 1) / layout.chunkWidth; ++across) {
+				chunks.push_back({ across, down, plane });
+			}
+		}
+	}
+
+	const int stripes = std::max(1, std::min(cv::getNumThreads(), (int)chunks.size()));
+	std::atomic<size_t> next{ 0 };
+	std::atomic<bool> failed{ false };
+	std::atomic<std::int64_t> faultMicros{ 0 };
+	std::mutex errorMutex;
+	std::string firstError;
+	cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range) {
+		for (int stripe = range.start; stripe < range.end; ++stripe) {
+			TiffCursor cursor{ &file };
+			TIFF* tiff = open_tiff(cursor, path, page);
+			if (tiff == nullptr) {
+				failed = true;
+				continue;
+			}
+			std::vector<unsigned char> buffer(layout.chunkBytes);
+			for (size_t i = next++; i < chunks.size() && !failed; i = next++) {
+				const TiffChunk& chunk = chunks[i];
+				const std::uint32_t index = (std::uint32_t)(((std::uint64_t)chunk.plane * layout.chunksDown + chunk.down) * layout.chunksAcross + chunk.across);
+				const int y0 = chunk.down * layout.chunkHeight;
+				if (!layout.scanlines || wholeFile) {
+					const auto faultStart = std::chrono::steady_clock::now();
+					fault_in(file, TIFFGetStrileOffset(tiff, index), TIFFGetStrileByteCount(tiff, index));
+					faultMicros += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - faultStart).count();
+				}
+				if (layout.scanlines) {
+					// Only the grid rows are copied, but libtiff inflates every row before them.
+					const int y1 = std::min({ y0 + layout.chunkHeight, layout.height, region.y + region.height });
+					int y = region.y + (std::max(y0, region.y) - region.y + scale - 1) / scale * scale;
+					for (; y < y1; y += scale) {
+						if (TIFFReadScanline(tiff, buffer.data(), (std::uint32_t)y, (std::uint16_t)chunk.plane) < 0) {
+							break;
+						}
+						copy_tiff_rows(layout, chunk, buffer.data(), y, 1, region, scale, out);
+					}
+					if (y < y1) {
+						std::lock_guard<std::mutex> lock(errorMutex);
+						if (!failed.exchange(true)) {
+							firstError = "Cannot decode row " + std::to_string(y) + " of " + path;
+						}
+						break;
+					}
+					continue;
+				}
+				const tmsize_t got = layout.tiled
+					? TIFFReadEncodedTile(tiff, index, buffer.data(), (tmsize_t)buffer.size())
+					: TIFFReadEncodedStrip(tiff, index, buffer.data(), (tmsize_t)buffer.size());
+				if (got < 0) {
+					std::lock_guard<std::mutex> lock(errorMutex);
+					if (!failed.exchange(true)) {
+						firstError = "Cannot decode " + std::string(layout.tiled ? "tile " : "strip ") + std::to_string(index) + " of " + path;
+					}
+					break;
+				}
+				// The last strip is short, and libtiff says so by returning fewer bytes.
+				const size_t rowBytes = CV_ELEM_SIZE1(layout.depth) * (layout.separate ? 1 : layout.samples) * layout.chunkWidth;
+				const int rows = layout.tiled ? layout.chunkHeight : std::min(layout.chunkHeight, (int)((size_t)got / rowBytes));
+				copy_tiff_rows(layout, chunk, buffer.data(), y0, rows, region, scale, out);
+			}
+			TIFFClose(tiff);
+		}
+	}, stripes);
+
+	if (failed) {
+		out.release();
+		errorOut = firstError.empty() ? "Cannot open " + path : firstError;
+		return false;
+	}
+	const double faultMs = faultMicros / 1000.0 / stripes;
+	ioMs = std::chrono::duration<double, std::milli>(mapped - start).count() + faultMs;
+	decodeMs = std::max(0.0, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mapped).count() - faultMs);
+	return true;
+}
+
+// A whole page, point-sampled by `scale` for a proxy. False for layouts the reader leaves
+// to OpenCV (see read_tiff_layout); the caller falls back to imread.
+bool read_tiff_image(const std::string& path, int page, int scale, cv::Mat& out, double& ioMs, double& decodeMs, std::string& errorOut) {
+	return decode_tiff(path, page, cv::Rect(), scale, true, out, ioMs, decodeMs, errorOut);
+}
+
+// Full-resolution pixels of `region`, decoding only the strips or tiles it touches. Lets
+// the canvas read exact values from a file too large to hold decoded.
+bool read_tiff_region(const std::string& path, int page, cv::Rect region, cv::Mat& out, std::string& errorOut) {
+	double ioMs = 0.0, decodeMs = 0.0;
+	return decode_tiff(path, page, region, 1, false, out, ioMs, decodeMs, errorOut);
+}
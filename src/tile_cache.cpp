@@ -0,0 +1,113 @@
+#include "ImagePixelViewer.h"
+
+// Uploads are spread over frames so scrolling into a fresh region never stalls on dozens of tiles.
+static const int kMaxTileUploadsPerFrame = 8;
+
+static void evict_tile(TileCache& cache, std::unordered_map<TileKey, TextureTile, TileKeyHash>::iterator it) {
+	cache.residentBytes -= it->second.bytes;
+	release_texture(it->second.texture);
+	cache.lru.erase(it->second.lruPos);
+	cache.tiles.erase(it);
+}
+
+// Evicts least-recently-drawn tiles until `incoming` bytes fit. Tiles drawn this frame stay:
+// when the visible set alone exceeds the budget it is allowed to, rather than leaving holes
+// in the image; later uploads evict the excess once those tiles are off screen.
+static void make_room(TileCache& cache, size_t incoming, std::uint64_t frame) {
+	const size_t budget = (size_t)cache.budgetMB * 1024 * 1024;
+	while (cache.residentBytes + incoming > budget && !cache.lru.empty()) {
+		auto it = cache.tiles.find(cache.lru.back());
+		if (it->second.lastUsedFrame == frame) {
+			return;
+		}
+		evict_tile(cache, it);
+	}
+}
+
+// Draws the part of the image that intersects the current clip rect, one texture per tile,
+// stretched over `size` on screen and taken from the pyramid level that matches the
+// resulting zoom. Returns false while visible tiles are still waiting for upload.
+bool draw_tiled_image(ImDrawList* drawList, TileCache& cache, const ImageState& state, ImVec2 topLeft, ImVec2 size, std::uint64_t frame) {
+	if (state.previewRGBA.empty() || size.x <= 0.0f || size.y <= 0.0f) {
+		return true;
+	}
+	const int level = pyramid_level_for_zoom(state, size.x / (float)state.previewRGBA.cols);
+	const cv::Mat& rgba = (level == 0) ? state.previewRGBA : state.previewPyramid[level - 1];
+	// Screen pixels per texel of this level; odd sizes round up when halving, so per axis.
+	const float scaleX = size.x / (float)rgba.cols;
+	const float scaleY = size.y / (float)rgba.rows;
+	const int tileSize = cache.tileSize;
+	const int tilesX = (rgba.cols + tileSize - 1) / tileSize;
+	const int tilesY = (rgba.rows + tileSize - 1) / tileSize;
+
+	const ImVec2 clipMin = drawList->GetClipRectMin();
+	const ImVec2 clipMax = drawList->GetClipRectMax();
+	const int tx0 = std::max(0, (int)std::floor((clipMin.x - topLeft.x) / (tileSize * scaleX)));
+	const int ty0 = std::max(0, (int)std::floor((clipMin.y - topLeft.y) / (tileSize * scaleY)));
+	const int tx1 = std::min(tilesX - 1, (int)std::floor((clipMax.x - topLeft.x) / (tileSize * scaleX)));
+	const int ty1 = std::min(tilesY - 1, (int)std::floor((clipMax.y - topLeft.y) / (tileSize * scaleY)));
+
+	bool complete = true;
+	int uploads = 0;
+	for (int ty = ty0; ty <= ty1; ++ty) {
+		for (int tx = tx0; tx <= tx1; ++tx) {
+			const TileKey key{ state.uid, level, tx, ty };
+			const cv::Rect rect(tx * tileSize, ty * tileSize,
+				std::min(tileSize, rgba.cols - tx * tileSize),
+				std::min(tileSize, rgba.rows - ty * tileSize));
+
+			auto it = cache.tiles.find(key);
+			const bool stale = (it == cache.tiles.end()) || it->second.version != state.previewVersion;
+			if (stale && uploads >= kMaxTileUploadsPerFrame) {
+				complete = false;
+				if (it == cache.tiles.end()) {
+					continue;
+				}
+				// Keep showing the outdated tile until its turn comes.
+			}
+			else if (stale) {
+				const size_t bytes = (size_t)rect.area() * rgba.elemSize();
+				if (it == cache.tiles.end()) {
+					make_room(cache, bytes, frame);
+					cache.lru.push_front(key);
+					it = cache.tiles.emplace(key, TextureTile{}).first;
+					it->second.lruPos = cache.lru.begin();
+				}
+				std::string error;
+				if (!create_texture_from_rgba(it->second.texture, rgba(rect), error)) {
+					std::fprintf(stderr, "Tile upload failed: %s\n", error.c_str());
+					evict_tile(cache, it);
+					continue;
+				}
+				cache.residentBytes = cache.residentBytes - it->second.bytes + bytes;
+				it->second.bytes = bytes;
+				it->second.version = state.previewVersion;
+				uploads++;
+			}
+
+			it->second.lastUsedFrame = frame;
+			cache.lru.splice(cache.lru.begin(), cache.lru, it->second.lruPos);
+
+			const ImVec2 p0(topLeft.x + rect.x * scaleX, topLeft.y + rect.y * scaleY);
+			const ImVec2 p1(p0.x + rect.width * scaleX, p0.y + rect.height * scaleY);
+			drawList->AddImage((ImTextureID)(uintptr_t)it->second.texture.id, p0, p1);
+		}
+	}
+	return complete;
+}
+
+void release_image_tiles(TileCache& cache, std::uint64_t uid) {
+	for (auto it = cache.tiles.begin(); it != cache.tiles.end();) {
+		auto next = std::next(it);
+		if (it->first.uid == uid) {
+			evict_tile(cache, it);
+		}
+		it = next;
+	}
+}
+
+void release_tile_cache(TileCache& cache) {
+	while (!cache.tiles.empty()) {
+		evict_tile(cache, cache.tiles.begin());
+	}
+}
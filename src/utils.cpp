@@ -15,17 +15,28 @@ void glfw_error_callback(int error, const char* description) {
 	std::fprintf(stderr, "GLFW Error %d: %s\n", error, description);
 }
 
+// Wakes the main loop out of glfwWaitEventsTimeout. Safe to call from any thread.
+void request_redraw() {
+	glfwPostEmptyEvent();
+}
+
 
 // Common OpenCV-readable extensions (depends on your build/codecs)
 bool is_opencv_supported_ext(const std::string& extLower) {
 	return kExt.count(extLower) != 0;
 }
+// List entries can stand for part of a file: "<file>::<page>" in a multi-page image,
+// "<file>::<member>" and "<file>::<frame>" in a NumPy array. This is the file on disk.
+std::string entry_file_path(const std::string& path) {
+	const std::string arrayFile = array_file_path(path);
+	return arrayFile != path ? arrayFile : page_file_path(path);
+}
 std::string to_lower(std::string s) {
 	std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return (char)std::tolower(c); });
 	return s;
 }
 
-static std::string normalize_path(const fs::path& path) {
+std::string normalize_path(const fs::path& path) {
 	std::error_code ec;
 	fs::path absolutePath = fs::absolute(path, ec);
 	if (ec) {
@@ -46,36 +57,76 @@ void drop_callback(GLFWwindow* window, int count, const char** paths) {
 	for (int i = 0; i < count; i++) {
 		const std::string dropped = paths[i];
 		fs::path p = fs::u8path(dropped);
+		std::error_code ec;
+		if (fs::is_directory(p, ec)) {
+			open_folder(*states, p);
+			continue;
+		}
 		std::string extLower = to_lower(p.extension().string());
+		if (is_video_ext(extLower)) {
+			const std::string normalizedPath = normalize_path(p);
+			if (states->knownPaths.count(normalizedPath) == 0) {
+				open_video(add_image_entry(*states, p, normalizedPath));
+			}
+			continue;
+		}
+		if (is_array_ext(extLower)) {
+			open_array_file(*states, p);
+			continue;
+		}
+		if (is_raw_ext(extLower)) {
+			// A raw file with a saved layout opens straight away; otherwise ask for one first.
+			const std::string normalizedPath = normalize_path(p);
+			RawFormat format;
+			std::string formatError;
+			if (states->knownPaths.count(normalizedPath) != 0) {
+				continue;
+			}
+			if (read_raw_format(dropped, format, formatError)) {
+				queue_image_decode(*states, add_image_entry(*states, p, normalizedPath));
+			}
+			else {
+				states->pendingRawPaths.push_back(dropped);
+			}
+			continue;
+		}
 		if (extLower.empty() || !is_opencv_supported_ext(extLower)) {
 			showError(("Not a valid image file: " + string(paths[i])).c_str());
 			continue;
 		}
 		const std::string normalizedPath = normalize_path(p);
-		bool alreadyLoaded = false;
-		for (const auto& existing : states->states) {
-			if (normalize_path(fs::path(existing.currentPath)) == normalizedPath) {
-				alreadyLoaded = true;
-				break;
-			}
-		}
-		if (alreadyLoaded) {
+		if (states->knownPaths.count(normalizedPath) != 0) {
 			continue;
 		}
-		ImageState state;
-		state.grayApplied = states->Gray_Image;
-		state.autoContrastApplied = states->Auto_Maximize_Contrast;
-		state.pseudoColorApplied = states->One_Channel_Pseudo_Color;
-		state.ignoreAlphaApplied = states->Four_Channel_Ignore_Alpha;
-		state.currentPath = p.string();
-		state.filename = p.filename().u8string();
+		ImageState& state = add_image_entry(*states, p, normalizedPath);
 		std::cout << state.currentPath << endl;
-		string load_error;
-		if (!load_image_from_path(state, load_error, true)) {
-			showError(load_error.c_str());
-			continue;
+
+		// A cache hit fills the list entry now and defers the decode until the image is shown.
+		std::string stampError;
+		ThumbnailCacheEntry cached;
+		if (read_file_stamp(state.currentPath, state.lastWriteTime, state.lastFileSize, stampError)
+			&& read_thumbnail_cache(normalizedPath, state.lastWriteTime, state.lastFileSize, desired_preview_options(*states), cached)) {
+			state.hasFileStamp = true;
+			state.width = cached.width;
+			state.height = cached.height;
+			state.channels = cached.channels;
+			state.depth = cached.depth;
+			state.thumbRGBA = cached.thumbRGBA;
+			state.previewVersion++;
+			state.loadStatus = LoadStatus::Unloaded;
+		}
+		else {
+			// Header dims show in the list while the decode is pending.
+			ImageHeader header;
+			if (probe_image_header(state.currentPath, header)) {
+				state.width = header.width;
+				state.height = header.height;
+				state.channels = header.channels;
+				state.depth = depth_to_string(header.depth);
+			}
+			// Decode off the GL thread; the entry shows as pending until the worker reports back.
+			queue_image_decode(*states, state);
 		}
-		states->states.push_back(state);
 	}
 }
 
@@ -85,6 +136,7 @@ void release_texture(ImageTexture& texture) {
 		texture.id = 0;
 		texture.width = 0;
 		texture.height = 0;
+		texture.internalFormat = 0;
 	}
 }
 
@@ -102,84 +154,8 @@ void copy_path_to_buffer(ImageState& state, const std::string& path) {
 
 	std::memcpy(state.inputBuffer.data(), slice.data(), slice.size());
 }
-//bool create_texture_from_rgba(ImageTexture& texture, const cv::Mat& rgbaImage, std::string& error) {
-//	if (rgbaImage.empty()) {
-//		error = "Cannot create texture: image is empty.";
-//		return false;
-//	}
-//	if (rgbaImage.type() != CV_8UC4) {
-//		error = "Texture upload expects CV_8UC4 data.";
-//		return false;
-//	}
-//
-//	cv::Mat upload = rgbaImage;
-//	if (!upload.isContinuous()) {
-//		upload = upload.clone();
-//	}
-//
-//	release_texture(texture);
-//
-//	glGenTextures(1, &texture.id);
-//	if (texture.id == 0) {
-//		error = "Failed to generate OpenGL texture.";
-//		return false;
-//	}
-//
-//	texture.width = upload.cols;
-//	texture.height = upload.rows;
-//
-//	glBindTexture(GL_TEXTURE_2D, texture.id);
-//	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-//	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-//	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-//	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-//	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-//	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture.width, texture.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, upload.data);
-//	glBindTexture(GL_TEXTURE_2D, 0);
-//
-//	GLenum glError = glGetError();
-//	if (glError != GL_NO_ERROR) {
-//		release_texture(texture);
-//		std::ostringstream oss;
-//		oss << "OpenGL error during texture upload: 0x" << std::hex << glError;
-//		error = oss.str();
-//		return false;
-//	}
-//
-//	return true;
-//}
-bool create_texture_from_rgba(ImageTexture& texture, const cv::Mat& rgbaImage, std::string& error) {
-	if (rgbaImage.empty()) {
-		error = "Cannot create texture: image is empty.";
-		return false;
-	}
-	GLint internalFormat = 0;
-	GLenum dataType = 0;
-	switch (rgbaImage.type()) {
-	case CV_8UC4:
-		internalFormat = GL_RGBA8;
-		dataType = GL_UNSIGNED_BYTE;
-		break;
-	case CV_16UC4:
-		internalFormat = GL_RGBA16;
-		dataType = GL_UNSIGNED_SHORT;
-		break;
-	case CV_32FC4:
-		internalFormat = GL_RGBA32F;
-		dataType = GL_FLOAT;
-		break;
-	default:
-		error = "Texture upload expects CV_8UC4, CV_16UC4, or CV_32FC4 data.";
-		return false;
-	}
-
-	const cv::Mat* src = &rgbaImage;
-	cv::Mat upload;
-	if (!rgbaImage.isContinuous()) {
-		upload = rgbaImage.clone();
-		src = &upload;
-	}
-
+// Empty storage with the viewer's sampling setup (nearest, no mipmaps, clamped edges).
+bool allocate_texture(ImageTexture& texture, int width, int height, GLint internalFormat, GLenum dataType, std::string& error) {
 	release_texture(texture);
 
 	glGenTextures(1, &texture.id);
@@ -188,8 +164,9 @@ bool create_texture_from_rgba(ImageTexture& texture, const cv::Mat& rgbaImage, s
 		return false;
 	}
 
-	texture.width = src->cols;
-	texture.height = src->rows;
+	texture.width = width;
+	texture.height = height;
+	texture.internalFormat = internalFormat;
 
 	glBindTexture(GL_TEXTURE_2D, texture.id);
 
@@ -201,24 +178,56 @@ bool create_texture_from_rgba(ImageTexture& texture, const cv::Mat& rgbaImage, s
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);      // safe edges
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-	// Upload (RGBA)
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, texture.width, texture.height, 0,
-		GL_RGBA, dataType, src->data);
+	// Allocate once; immutable storage where available so the driver can skip revalidation.
+	if (GLEW_ARB_texture_storage) {
+		glTexStorage2D(GL_TEXTURE_2D, 1, internalFormat, texture.width, texture.height);
+	}
+	else {
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, texture.width, texture.height, 0,
+			GL_RGBA, dataType, nullptr);
+	}
 
 	glBindTexture(GL_TEXTURE_2D, 0);
 
 	if (GLenum glError = glGetError(); glError != GL_NO_ERROR) {
 		release_texture(texture);
 		std::ostringstream oss;
-		oss << "OpenGL error during texture upload: 0x" << std::hex << glError;
+		oss << "OpenGL error during texture allocation: 0x" << std::hex << glError;
 		error = oss.str();
 		return false;
 	}
 	return true;
 }
 
-static const char* depth_to_string(int depth) {
+bool create_texture_from_rgba(ImageTexture& texture, const cv::Mat& rgbaImage, std::string& error) {
+	if (rgbaImage.empty()) {
+		error = "Cannot create texture: image is empty.";
+		return false;
+	}
+	GLint internalFormat = 0;
+	GLenum dataType = 0;
+	if (!texture_format_for(rgbaImage.type(), internalFormat, dataType)) {
+		error = "Texture upload expects CV_8UC4, CV_16UC4, or CV_32FC4 data.";
+		return false;
+	}
+
+	// Same size and format: keep the storage and stream the new pixels into it.
+	if (texture.id != 0 && texture.width == rgbaImage.cols && texture.height == rgbaImage.rows
+		&& texture.internalFormat == internalFormat) {
+		return upload_texture_pixels(texture, rgbaImage, 0, 0, error);
+	}
+
+	if (!allocate_texture(texture, rgbaImage.cols, rgbaImage.rows, internalFormat, dataType, error)) {
+		return false;
+	}
+	if (!upload_texture_pixels(texture, rgbaImage, 0, 0, error)) {
+		release_texture(texture);
+		return false;
+	}
+	return true;
+}
+
+const char* depth_to_string(int depth) {
 	switch (depth) {
 	case CV_8U:  return "8U";
 	case CV_8S:  return "8S";
@@ -230,22 +239,13 @@ static const char* depth_to_string(int depth) {
 	default:     return "Unknown";
 	}
 }
-std::string describe_mat(const cv::Mat& mat) {
-	if (mat.empty()) {
-		return "empty";
-	}
-
-	std::ostringstream oss;
-	oss << mat.cols << "x" << mat.rows << " x" << mat.channels() << " " << depth_to_string(mat.depth());
-	return oss.str();
-}
 static inline cv::Mat makeThumbnailLetterboxed(const cv::Mat& srcRGBA,
 	int thumbW = thumbWidth,
 	int thumbH = thumbHeight,
 	cv::Scalar padColor = cv::Scalar(114, 114, 114, 255)) // BGRA
 {
 	CV_Assert(!srcRGBA.empty());
-	CV_Assert(srcRGBA.type() == CV_8UC4); // RGBA/BGRA
+	CV_Assert(srcRGBA.channels() == 4); // RGBA/BGRA, any depth
 
 	const int srcW = srcRGBA.cols;
 	const int srcH = srcRGBA.rows;
@@ -264,6 +264,12 @@ static inline cv::Mat makeThumbnailLetterboxed(const cv::Mat& srcRGBA,
 
 	cv::Mat resized;
 	cv::resize(srcRGBA, resized, cv::Size(newW, newH), 0, 0, interp);
+	// Narrow to 8 bit after shrinking, so 16U/32F previews never pay for a full-size conversion.
+	if (resized.depth() != CV_8U) {
+		cv::Mat resized8;
+		resized.convertTo(resized8, CV_8U);
+		resized = resized8;
+	}
 
 	// Create target canvas and center the resized image on it
 	cv::Mat canvas(thumbH, thumbW, CV_8UC4, padColor);
@@ -277,202 +283,106 @@ static inline cv::Mat makeThumbnailLetterboxed(const cv::Mat& srcRGBA,
 	resized.copyTo(canvas(cv::Rect(x, y, newW, newH)));
 	return canvas;
 }
-std::optional<std::string> update_preview_from_source(ImageState& state, std::string& errorOut) {
-	if (state.sourceOriginal.empty()) {
-		errorOut = "No source image available.";
-		return std::nullopt;
-	}
-
-	cv::Mat previewMat;
-	state.hasMinMax = false;
-	state.minVal = 0.0;
-	state.maxVal = 0.0;
-
-	if (!state.autoContrastApplied) {
-		switch (state.sourceOriginal.depth()) {
-		case CV_8U:
-			previewMat = state.sourceOriginal;
-			break;
-		case CV_8S: {
-			cv::Mat converted;
-			state.sourceOriginal.convertTo(converted, CV_8U);
-			previewMat = converted;
-			break;
-		}
-		case CV_16U:
-			previewMat = state.sourceOriginal;
-			break;
-		case CV_16S: {
-			cv::Mat converted;
-			state.sourceOriginal.convertTo(converted, CV_16U);
-			previewMat = converted;
-			break;
-		}
-		case CV_32S:
-		case CV_32F:
-		case CV_64F: {
-			cv::Mat converted;
-			state.sourceOriginal.convertTo(converted, CV_32F);
-			previewMat = converted;
-			break;
-		}
-		default:
-			errorOut = "Unsupported image depth.";
-			return std::nullopt;
-		}
-	}
-	else {
-		std::vector<cv::Mat> channels;
-		cv::split(state.sourceOriginal, channels);
-		if (channels.empty()) {
-			errorOut = "Failed to split image channels.";
-			return std::nullopt;
-		}
-
-		double minAcross = std::numeric_limits<double>::infinity();
-		double maxAcross = -std::numeric_limits<double>::infinity();
-
-		for (size_t i = 0; i < channels.size(); ++i) {
-			if (channels.size() == 4 && i == 3) {
-				cv::Mat alpha8;
-				channels[i].convertTo(alpha8, CV_8U);
-				channels[i] = alpha8;
-				continue;
-			}
-
-			cv::Mat floatChan;
-			channels[i].convertTo(floatChan, CV_32F);
-			double minVal = 0.0;
-			double maxVal = 0.0;
-			cv::minMaxLoc(floatChan, &minVal, &maxVal);
-			minAcross = std::min(minAcross, minVal);
-			maxAcross = std::max(maxAcross, maxVal);
-
-			cv::Mat normalized8;
-			if (minVal == maxVal) {
-				normalized8 = cv::Mat::zeros(floatChan.size(), CV_8U);
-			}
-			else {
-				floatChan.convertTo(normalized8, CV_8U, 255.0 / (maxVal - minVal), -minVal * 255.0 / (maxVal - minVal));
-			}
-			channels[i] = normalized8;
-		}
-
-		state.minVal = std::isfinite(minAcross) ? minAcross : 0.0;
-		state.maxVal = std::isfinite(maxAcross) ? maxAcross : 0.0;
-		state.hasMinMax = true;
+PreviewOptions desired_preview_options(const ImageStates& states) {
+	PreviewOptions options;
+	options.gray = states.Gray_Image;
+	options.autoContrast = states.Auto_Maximize_Contrast;
+	options.pseudoColor = states.One_Channel_Pseudo_Color;
+	options.ignoreAlpha = states.Four_Channel_Ignore_Alpha;
+	options.pyramidKeepExtremes = states.Pyramid_Keep_Extremes;
+	return options;
+}
 
-		cv::merge(channels, previewMat);
-	}
+PreviewOptions preview_options_of(const ImageState& state) {
+	PreviewOptions options;
+	options.gray = state.grayApplied;
+	options.autoContrast = state.autoContrastApplied;
+	options.pseudoColor = state.pseudoColorApplied;
+	options.ignoreAlpha = state.ignoreAlphaApplied;
+	options.pyramidKeepExtremes = state.pyramidKeepExtremesApplied;
+	return options;
+}
 
-	if (state.grayApplied && previewMat.channels() > 1) {
-		cv::Mat gray;
-		if (previewMat.channels() == 3) {
-			cv::cvtColor(previewMat, gray, cv::COLOR_BGR2GRAY);
-		}
-		else if (previewMat.channels() == 4) {
-			cv::cvtColor(previewMat, gray, cv::COLOR_BGRA2GRAY);
-		}
-		previewMat = gray;
+// Builds the display images for `source` without touching GL, so it can run on a worker thread.
+bool build_preview_images(const cv::Mat& source, const ImageStats& stats, const PreviewOptions& options, PreviewImages& out, std::string& errorOut, const CancelToken& cancel) {
+	if (!render_preview_rgba(source, stats, options, out, errorOut, cancel)) {
+		return false;
 	}
-
-	bool previewIsRGBA = false;
-	if (state.pseudoColorApplied && previewMat.channels() == 1) {
-		cv::Mat gray8;
-		if (previewMat.depth() == CV_8U) {
-			gray8 = previewMat;
-		}
-		else {
-			previewMat.convertTo(gray8, CV_8U);
-		}
-		cv::Mat colorBgr;
-		cv::applyColorMap(gray8, colorBgr, cv::COLORMAP_TURBO);
-		cv::cvtColor(colorBgr, previewMat, cv::COLOR_BGR2RGBA);
-		previewIsRGBA = true;
-	}
-
-	if (state.ignoreAlphaApplied && previewMat.channels() == 4) {
-		std::vector<cv::Mat> channels;
-		cv::split(previewMat, channels);
-		if (channels.size() == 4) {
-			switch (previewMat.depth()) {
-			case CV_8U:
-				channels[3].setTo(255);
-				break;
-			case CV_16U:
-				channels[3].setTo(65535);
-				break;
-			case CV_32F:
-				channels[3].setTo(1.0f);
-				break;
-			default:
-				break;
-			}
-			cv::merge(channels, previewMat);
-		}
+	if (!build_preview_pyramid(out.previewRGBA, options.pyramidKeepExtremes, out.pyramid, cancel)) {
+		errorOut = "Preview rebuild cancelled.";
+		return false;
 	}
+	// The smallest level is already close to thumbnail size.
+	out.thumbRGBA = makeThumbnailLetterboxed(out.pyramid.empty() ? out.previewRGBA : out.pyramid.back());
+	return true;
+}
 
-	state.preview8u = previewMat;
+// Uploads a finished preview; the *Applied flags always describe what is on screen.
+bool apply_preview_images(ImageState& state, PreviewImages& images, const PreviewOptions& options, std::string& errorOut) {
+	state.grayApplied = options.gray;
+	state.autoContrastApplied = options.autoContrast;
+	state.pseudoColorApplied = options.pseudoColor;
+	state.ignoreAlphaApplied = options.ignoreAlpha;
+	state.pyramidKeepExtremesApplied = options.pyramidKeepExtremes;
+	state.previewRGBA = images.previewRGBA;
+	state.previewPyramid = std::move(images.pyramid);
+	state.minVal = images.minVal;
+	state.maxVal = images.maxVal;
+	state.hasMinMax = images.hasMinMax;
+
+	state.thumbRGBA = images.thumbRGBA;
+
+	// Canvas tiles and the list thumbnail are uploaded lazily when they come into view;
+	// the version tells them to refresh.
+	state.previewVersion++;
+	return true;
+}
 
-	cv::Mat rgba;
-	if (previewIsRGBA) {
-		rgba = previewMat;
-	}
-	else {
-		switch (previewMat.channels()) {
-		case 1:
-			cv::cvtColor(previewMat, rgba, cv::COLOR_GRAY2RGBA);
-			break;
-		case 3:
-			cv::cvtColor(previewMat, rgba, cv::COLOR_BGR2RGBA);
-			break;
-		case 4:
-			cv::cvtColor(previewMat, rgba, cv::COLOR_BGRA2RGBA);
-			break;
-		default:
-			errorOut = "Unsupported channel count: " + std::to_string(previewMat.channels());
-			return std::nullopt;
+// Called for visible list rows only.
+bool ensure_thumbnail_texture(ThumbnailAtlas& atlas, ImageState& state, std::uint64_t frame) {
+	state.thumbLastUsedFrame = frame;
+	if (state.thumbRGBA.empty()) {
+		return state.thumbSlot >= 0;
+	}
+	if (state.thumbSlot < 0 || state.thumbVersion != state.previewVersion) {
+		std::string textureError;
+		if ((state.thumbSlot < 0 && !acquire_thumb_slot(atlas, state.thumbSlot, textureError))
+			|| !upload_thumb_slot(atlas, state.thumbSlot, state.thumbRGBA, textureError)) {
+			std::fprintf(stderr, "Thumbnail upload failed for %s: %s\n", state.filename.c_str(), textureError.c_str());
+			release_thumb_slot(atlas, state.thumbSlot);
+			return false;
 		}
+		state.thumbVersion = state.previewVersion;
 	}
+	return true;
+}
 
-	state.previewRGBA = rgba;
-
-	std::string textureError;
-	if (!create_texture_from_rgba(state.texture, state.previewRGBA, textureError)) {
-		errorOut = textureError;
-		return std::nullopt;
-	}
-
-	cv::Mat thumbSource = rgba;
-	if (thumbSource.type() != CV_8UC4) {
-		cv::Mat thumb8;
-		thumbSource.convertTo(thumb8, CV_8U);
-		thumbSource = thumb8;
+// Returns slots of rows that have not been on screen for a while to the atlas free list.
+void evict_unused_thumbnails(ImageStates& states) {
+	for (auto& state : states.states) {
+		if (state.thumbSlot >= 0 && state.thumbLastUsedFrame + kThumbEvictFrames < states.frameIndex) {
+			release_thumb_slot(states.thumbs, state.thumbSlot);
+		}
 	}
-	Mat thumb_img = makeThumbnailLetterboxed(thumbSource);
-	create_texture_from_rgba(state.texture_thumb, thumb_img, textureError);
-	std::ostringstream oss;
-	oss << "original " << describe_mat(state.sourceOriginal)
-		<< ", preview " << describe_mat(state.preview8u);
-
-	return oss.str();
 }
 
-static bool read_file_stamp(const std::string& path,
+bool read_file_stamp(const std::string& path,
 	fs::file_time_type& outWriteTime,
 	std::uintmax_t& outFileSize,
 	std::string& errorOut) {
+	// Pages and array members carry the stamp of the file that holds them.
+	const std::string file = entry_file_path(path);
 	std::error_code fsError;
-	if (!std::filesystem::exists(path, fsError) || !std::filesystem::is_regular_file(path, fsError)) {
+	if (!std::filesystem::exists(file, fsError) || !std::filesystem::is_regular_file(file, fsError)) {
 		errorOut = "File not found: " + path;
 		return false;
 	}
-	outWriteTime = std::filesystem::last_write_time(path, fsError);
+	outWriteTime = std::filesystem::last_write_time(file, fsError);
 	if (fsError) {
 		errorOut = "Failed to read file timestamp: " + path;
 		return false;
 	}
-	outFileSize = std::filesystem::file_size(path, fsError);
+	outFileSize = std::filesystem::file_size(file, fsError);
 	if (fsError) {
 		errorOut = "Failed to read file size: " + path;
 		return false;
@@ -480,142 +390,255 @@ static bool read_file_stamp(const std::string& path,
 	return true;
 }
 
-bool load_image_from_path(ImageState& state, std::string& errorOut, bool showErrors) {
-	string path = state.currentPath;
-	std::error_code fsError;
-	if (!std::filesystem::exists(path, fsError) || !std::filesystem::is_regular_file(path, fsError)) {
-		errorOut = "File not found: " + path;
-		return false;
-	}
+static std::string too_large_error(const ImageHeader& header, const std::string& path) {
+	std::ostringstream oss;
+	oss << "Image too large to decode: " << header.width << " x " << header.height << " x " << header.channels
+		<< " " << depth_to_string(header.depth) << " needs " << (estimated_decode_bytes(header) >> 20)
+		<< " MB (limit " << (kMaxDecodeBytes >> 20) << " MB): " << path;
+	return oss.str();
+}
 
-	cv::Mat loaded = cv::imread(path, cv::IMREAD_UNCHANGED);
-	if (loaded.empty()) {
-		errorOut = "Failed to load image via OpenCV.";
-		if (showErrors) {
-			showError(("Cannot load image file: " + state.currentPath).c_str());
+static bool decode_encoded_file(const std::string& path, cv::Size proxyTarget, DecodeResult& result, cv::Mat& loaded) {
+	// The header decides the route before any pixel memory is committed.
+	ImageHeader header;
+	const bool probed = probe_image_header(path, header);
+	ProxyPlan plan;
+	const bool planned = probed && plan_proxy_decode(header, proxyTarget, kMaxDecodeBytes, plan);
+	if (probed && header.format == ImageFormat::Tiff) {
+		// Strips and tiles are inflated on all cores; layouts the reader does not take go
+		// through OpenCV below, at full resolution or not at all.
+		std::string tiffError;
+		const int scale = planned ? plan.scale : 1;
+		if (read_tiff_image(path, 0, scale, loaded, result.ioMs, result.decodeMs, tiffError)) {
+			result.proxyScale = scale;
+			result.fullWidth = header.width;
+			result.fullHeight = header.height;
+			result.sizeLimited = estimated_decode_bytes(header) > kMaxDecodeBytes;
+			return true;
 		}
-		return false;
 	}
+	else if (planned) {
+		read_image_mapped(path, header.format, plan.flags, loaded, result.ioMs, result.decodeMs);
+	}
+	if (!loaded.empty()) {
+		result.proxyScale = plan.scale;
+		result.fullWidth = plan.fullWidth;
+		result.fullHeight = plan.fullHeight;
+		result.sizeLimited = estimated_decode_bytes(header) > kMaxDecodeBytes;
+	}
+	else {
+		if (probed && estimated_decode_bytes(header) > kMaxDecodeBytes) {
+			result.error = too_large_error(header, path);
+			return false;
+		}
+		if (!read_image_mapped(path, header.format, cv::IMREAD_UNCHANGED, loaded, result.ioMs, result.decodeMs)) {
+			result.error = "Cannot load image file: " + path;
+			return false;
+		}
+		result.proxyScale = 1;
+		result.fullWidth = loaded.cols;
+		result.fullHeight = loaded.rows;
+	}
+	return true;
+}
 
-	state.sourceOriginal = loaded;
-	state.width = loaded.cols;
-	state.height = loaded.cols;
-	state.channels = loaded.channels();
-	state.depth = depth_to_string(loaded.depth());
-	copy_path_to_buffer(state, path);
-
-	auto status = update_preview_from_source(state, errorOut);
-	if (!status) {
+// Headerless dump: the layout comes from the Raw Import dialog and the pixels stay in the
+// file mapping, so there is no decode step to time.
+static bool load_raw_file(const std::string& path, DecodeResult& result, cv::Mat& loaded) {
+	const auto start = std::chrono::steady_clock::now();
+	RawFormat format;
+	if (!read_raw_format(path, format, result.error) || !map_raw_image(path, format, loaded, result.error)) {
 		return false;
 	}
+	result.ioMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	result.decodeMs = 0.0;
+	result.proxyScale = 1;
+	result.fullWidth = loaded.cols;
+	result.fullHeight = loaded.rows;
+	return true;
+}
 
-	state.zoom = 1.0f;
-	std::filesystem::path fsPath(path);
-	std::ostringstream oss;
-	std::string displayName = fsPath.filename().string();
-	if (displayName.empty()) {
-		displayName = fsPath.string();
-	}
-	fs::file_time_type writeTime{};
-	std::uintmax_t fileSize = 0;
-	std::string stampError;
-	if (read_file_stamp(path, writeTime, fileSize, stampError)) {
-		state.lastWriteTime = writeTime;
-		state.lastFileSize = fileSize;
-		state.hasFileStamp = true;
+// An array entry: header-described pixels, mapped in place where the layout allows.
+static bool load_array_file(const std::string& path, DecodeResult& result, cv::Mat& loaded) {
+	const auto start = std::chrono::steady_clock::now();
+	if (!read_array_image(path, loaded, result.error)) {
+		return false;
 	}
+	result.ioMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	result.decodeMs = 0.0;
+	result.proxyScale = 1;
+	result.fullWidth = loaded.cols;
+	result.fullHeight = loaded.rows;
 	return true;
 }
 
-bool rebuild_preview_from_source(ImageState& state, bool grayImage, bool autoMaximizeContrast, bool oneChannelPseudoColor, bool ignoreAlpha, std::string& errorOut) {
-	if (state.sourceOriginal.empty()) {
-		errorOut = "No source image available.";
+// Later pages of a multi-page file. Each page's own header is held to the same size limit
+// as the first: TIFF pages try the parallel reader, point-sampled when too large, and
+// anything else over the limit is refused rather than decoded.
+static bool load_page_file(const std::string& path, int page, DecodeResult& result, cv::Mat& loaded) {
+	const auto start = std::chrono::steady_clock::now();
+	ImageHeader header;
+	const bool probed = probe_image_header(path, header, page);
+	const bool tooLarge = probed && estimated_decode_bytes(header) > kMaxDecodeBytes;
+	if (probed && header.format == ImageFormat::Tiff) {
+		ProxyPlan plan;
+		const int scale = plan_proxy_decode(header, cv::Size(), kMaxDecodeBytes, plan) ? plan.scale : 1;
+		std::string tiffError;
+		if (read_tiff_image(path, page, scale, loaded, result.ioMs, result.decodeMs, tiffError)) {
+			result.proxyScale = scale;
+			result.fullWidth = header.width;
+			result.fullHeight = header.height;
+			result.sizeLimited = tooLarge;
+			return true;
+		}
+	}
+	if (tooLarge) {
+		result.error = too_large_error(header, path);
 		return false;
 	}
-	state.grayApplied = grayImage;
-	state.autoContrastApplied = autoMaximizeContrast;
-	state.pseudoColorApplied = oneChannelPseudoColor;
-	state.ignoreAlphaApplied = ignoreAlpha;
-	auto status = update_preview_from_source(state, errorOut);
-	return status.has_value();
+	if (!read_image_page(path, page, loaded, result.error)) {
+		return false;
+	}
+	result.ioMs = 0.0;
+	result.decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	result.proxyScale = 1;
+	result.fullWidth = loaded.cols;
+	result.fullHeight = loaded.rows;
+	return true;
 }
 
-bool refresh_image_if_changed(ImageState& state, std::string& errorOut) {
-	if (state.currentPath.empty()) {
+// Reads and previews `path` without touching GL or any ImageState; safe to call from worker threads.
+// A non-empty `proxyTarget` allows a reduced decode sized for that canvas (see plan_proxy_decode).
+bool decode_image_file(const std::string& path, const PreviewOptions& options, DecodeResult& result, cv::Size proxyTarget) {
+	std::error_code fsError;
+	const std::string filePath = entry_file_path(path);
+	if (!std::filesystem::exists(filePath, fsError) || !std::filesystem::is_regular_file(filePath, fsError)) {
+		result.error = "File not found: " + path;
 		return false;
 	}
 
-	fs::file_time_type writeTime{};
-	std::uintmax_t fileSize = 0;
+	// Stamp before reading so a write racing the decode is still seen as a change later.
 	std::string stampError;
-	if (!read_file_stamp(state.currentPath, writeTime, fileSize, stampError)) {
+	result.hasFileStamp = read_file_stamp(path, result.writeTime, result.fileSize, stampError);
+
+	cv::Mat loaded;
+	const std::string extLower = to_lower(fs::path(filePath).extension().string());
+	const int page = page_of_path(path);
+	const bool decoded = is_raw_ext(extLower) ? load_raw_file(path, result, loaded)
+		: is_array_ext(extLower) ? load_array_file(path, result, loaded)
+		: page > 0 ? load_page_file(filePath, page, result, loaded)
+		: decode_encoded_file(filePath, proxyTarget, result, loaded);
+	if (!decoded) {
 		return false;
 	}
-
-	if (!state.hasFileStamp) {
-		state.lastWriteTime = writeTime;
-		state.lastFileSize = fileSize;
-		state.hasFileStamp = true;
+	if (page < 0 && is_paged_ext(extLower)) {
+		result.pageCount = count_image_pages(filePath);
+	}
+	result.source = loaded;
+	compute_image_stats(result.source, result.stats);
+	if (!build_preview_images(result.source, result.stats, options, result.preview, result.error)) {
 		return false;
 	}
 
-	if (writeTime == state.lastWriteTime && fileSize == state.lastFileSize) {
+	if (result.cacheThumbnail && result.hasFileStamp) {
+		ThumbnailCacheEntry entry;
+		entry.width = result.fullWidth;
+		entry.height = result.fullHeight;
+		entry.channels = loaded.channels();
+		entry.depth = depth_to_string(loaded.depth());
+		entry.thumbRGBA = result.preview.thumbRGBA;
+		write_thumbnail_cache(normalize_path(fs::path(path)), result.writeTime, result.fileSize, options, entry);
+	}
+	return true;
+}
+
+// GL-thread half of a load: adopts the decoded pixels and uploads the textures.
+bool apply_decoded_image(ImageState& state, DecodeResult& result, std::string& errorOut) {
+	state.sourceOriginal = result.source;
+	state.stats = std::move(result.stats);
+	state.width = result.fullWidth;
+	state.height = result.fullHeight;
+	state.proxyScale = result.proxyScale;
+	state.sizeLimited = result.sizeLimited;
+	state.exactTile.release();
+	state.exactTileRect = cv::Rect();
+	state.exactTileFailed = false;
+	state.loadIoMs = result.ioMs;
+	state.loadDecodeMs = result.decodeMs;
+	if (result.proxyScale == 1) {
+		state.fullResPending = false;
+	}
+	state.channels = result.source.channels();
+	state.depth = depth_to_string(result.source.depth());
+	copy_path_to_buffer(state, state.currentPath);
+
+	if (!apply_preview_images(state, result.preview, result.options, errorOut)) {
 		return false;
 	}
 
-	const bool wasFit = state.fitToWindow;
-	const float oldZoom = state.zoom;
-	const float oldMinZoom = state.minZoom;
-	const ImVec2 oldPan = state.pan;
+	state.zoom = 1.0f;
+	if (result.hasFileStamp) {
+		state.lastWriteTime = result.writeTime;
+		state.lastFileSize = result.fileSize;
+		state.hasFileStamp = true;
+	}
+	return true;
+}
 
-	std::string loadError;
-	if (!load_image_from_path(state, loadError, false)) {
-		errorOut = loadError;
+// Called for files the watcher reported; queues a background reload if the stamp really moved.
+bool refresh_image_if_changed(ImageStates& states, ImageState& state, std::string& errorOut) {
+	if (state.currentPath.empty()) {
 		return false;
 	}
 
-	state.lastWriteTime = writeTime;
-	state.lastFileSize = fileSize;
-	state.hasFileStamp = true;
-
-	if (wasFit) {
-		state.fitToWindow = true;
-		state.minZoom = -1.0f;
+	fs::file_time_type writeTime{};
+	std::uintmax_t fileSize = 0;
+	if (!read_file_stamp(state.currentPath, writeTime, fileSize, errorOut)) {
+		return false;
 	}
-	else {
-		state.fitToWindow = false;
-		state.zoom = oldZoom;
-		state.pan = oldPan;
-		state.minZoom = oldMinZoom;
+
+	if (state.hasFileStamp && writeTime == state.lastWriteTime && fileSize == state.lastFileSize) {
+		return false;
 	}
 
+	// Stay at full resolution if the view already had it.
+	queue_image_decode(states, state, true, state.proxyScale == 1 && !state.sourceOriginal.empty());
 	return true;
 }
-static std::vector<ChannelLabel> make_channel_labels(const cv::Mat& mat) {
-	std::vector<ChannelLabel> labels;
-	int channels = mat.channels();
-	labels.reserve(channels);
 
+// Allocation-free form for per-frame drawing: fills `labels` and returns how many are used.
+// Channels past the fourth are left out.
+int make_channel_labels(int channels, std::array<ChannelLabel, 4>& labels) {
 	if (channels == 1) {
-		labels.push_back({ 0, "Gray" });
-	}
-	else if (channels == 3) {
-		labels.push_back({ 2, "R" });
-		labels.push_back({ 1, "G" });
-		labels.push_back({ 0, "B" });
+		labels[0] = { 0, "Gray" };
+		return 1;
 	}
-	else if (channels == 4) {
-		labels.push_back({ 2, "R" });
-		labels.push_back({ 1, "G" });
-		labels.push_back({ 0, "B" });
-		labels.push_back({ 3, "A" });
+	if (channels == 3 || channels == 4) {
+		labels[0] = { 2, "R" };
+		labels[1] = { 1, "G" };
+		labels[2] = { 0, "B" };
+		labels[3] = { 3, "A" };
+		return channels;
 	}
-	else {
-		for (int i = 0; i < channels; ++i) {
-			labels.push_back({ i, nullptr });
-		}
+	const int count = std::clamp(channels, 0, 4);
+	for (int i = 0; i < count; ++i) {
+		labels[i] = { i, nullptr };
 	}
+	return count;
+}
 
+std::vector<ChannelLabel> make_channel_labels(const cv::Mat& mat) {
+	const int channels = mat.channels();
+	if (channels <= 4) {
+		std::array<ChannelLabel, 4> fixed;
+		const int count = make_channel_labels(channels, fixed);
+		return std::vector<ChannelLabel>(fixed.begin(), fixed.begin() + count);
+	}
+	std::vector<ChannelLabel> labels;
+	labels.reserve(channels);
+	for (int i = 0; i < channels; ++i) {
+		labels.push_back({ i, nullptr });
+	}
 	return labels;
 }
 template <typename T>
@@ -676,22 +699,36 @@ std::string format_pixel_value(const cv::Mat& mat, int x, int y) {
 }
 
 
+void remove_image_at(ImageStates& states, int index) {
+	if (index < 0 || index >= (int)states.states.size()) return;
+
+	const std::string& normalizedPath = states.states[index].normalizedPath;
+	const std::string watchedPath = array_file_path(normalizedPath);
+	if (watchedPath == normalizedPath || count_array_file_entries(states, watchedPath) == 1) {
+		unwatch_file(states.watcher, watchedPath);
+	}
+	states.knownPaths.erase(states.states[index].normalizedPath);
+
+	// Release GL resources
+	release_image_tiles(states.tiles, states.states[index].uid);
+	release_thumb_slot(states.thumbs, states.states[index].thumbSlot);
+
+	// Remove from vector
+	states.states.erase(states.states.begin() + index);
+
+	// Fix selection
+	if (states.states.empty()) {
+		states.selected = 0;
+	}
+	else if (states.selected > index) {
+		states.selected--;
+	}
+	else {
+		states.selected = std::min(states.selected, (int)states.states.size() - 1);
+	}
+}
+
 void DeleteSelected(ImageStates& states) {
     if (states.states.empty()) return;
-    int del = states.selected;
-    if (del < 0 || del >= (int)states.states.size()) return;
-
-    // Release GL resources
-    release_texture(states.states[del].texture);
-    release_texture(states.states[del].texture_thumb);
-
-    // Remove from vector
-    states.states.erase(states.states.begin() + del);
-
-    // Fix selection
-    if (states.states.empty()) {
-        states.selected = 0;
-    } else {
-        states.selected = std::min(del, (int)states.states.size() - 1);
-    }
+    remove_image_at(states, states.selected);
 }
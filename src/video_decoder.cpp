@@ -0,0 +1,110 @@
+#include "ImagePixelViewer.h"
+
+bool is_video_ext(const std::string& extLower) {
+	return kVideoExt.count(extLower) != 0;
+}
+
+static void video_decoder_loop(VideoDecoder* video) {
+	cv::VideoCapture capture(video->path);
+	{
+		std::lock_guard<std::mutex> lock(video->mutex);
+		if (!capture.isOpened()) {
+			video->error = "Cannot open video file: " + video->path;
+		}
+		else {
+			video->frameCount = std::max(0, (int)capture.get(cv::CAP_PROP_FRAME_COUNT));
+			video->width = (int)capture.get(cv::CAP_PROP_FRAME_WIDTH);
+			video->height = (int)capture.get(cv::CAP_PROP_FRAME_HEIGHT);
+			video->fps = capture.get(cv::CAP_PROP_FPS);
+			video->opened = true;
+			if (video->frameCount == 0) {
+				video->error = "Video has no frames: " + video->path;
+			}
+		}
+	}
+	request_redraw();
+	if (!capture.isOpened()) {
+		return;
+	}
+
+	// Where the capture really is, so a seek is only issued when the wanted frame jumps.
+	int streamPosition = 0;
+	std::unique_lock<std::mutex> lock(video->mutex);
+	for (;;) {
+		video->wake.wait(lock, [video] {
+			return video->stopping || ((int)video->frames.size() < kVideoQueueFrames
+				&& video->position < std::min(video->wantEnd, video->frameCount));
+		});
+		if (video->stopping) {
+			return;
+		}
+		const int frame = video->position;
+		const std::uint64_t generation = video->generation;
+		const PreviewOptions options = video->options;
+		lock.unlock();
+
+		if (frame != streamPosition) {
+			capture.set(cv::CAP_PROP_POS_FRAMES, frame);
+		}
+		cv::Mat mat;
+		const bool read = capture.read(mat) && !mat.empty();
+		streamPosition = frame + 1;
+
+		DecodeResult result;
+		result.sequenceFrame = frame;
+		result.options = options;
+		if (read) {
+			result.source = mat;
+			result.fullWidth = mat.cols;
+			result.fullHeight = mat.rows;
+			compute_image_stats(result.source, result.stats);
+			result.ok = build_preview_images(result.source, result.stats, options, result.preview, result.error);
+		}
+
+		lock.lock();
+		if (!read) {
+			// Container frame counts are estimates; the stream ends where reading stops.
+			if (frame == 0) {
+				video->error = "Cannot decode video file: " + video->path;
+				video->frameCount = 0;
+			}
+			else {
+				video->frameCount = std::min(video->frameCount, frame);
+			}
+			lock.unlock();
+			request_redraw();
+			lock.lock();
+			continue;
+		}
+		// Frames decoded before a seek are still correct frames; only the position moved.
+		if (generation == video->generation) {
+			video->position = frame + 1;
+		}
+		video->frames.push_back(std::move(result));
+		lock.unlock();
+		request_redraw();
+		lock.lock();
+	}
+}
+
+// Turns a list entry into a player over the frames of the video at its path. The entry
+// shows its first frame once the decoder thread has opened the file.
+void open_video(ImageState& state) {
+	auto player = std::make_shared<SequencePlayer>();
+	player->video = std::make_shared<VideoDecoder>();
+	player->video->path = state.currentPath;
+	player->video->thread = std::thread(video_decoder_loop, player->video.get());
+	state.sequence = std::move(player);
+	state.loadStatus = LoadStatus::Queued;
+}
+
+void stop_video_decoder(VideoDecoder& video) {
+	{
+		std::lock_guard<std::mutex> lock(video.mutex);
+		video.stopping = true;
+	}
+	video.wake.notify_all();
+	if (video.thread.joinable()) {
+		video.thread.join();
+	}
+}
@@ -0,0 +1,430 @@
+#include "ImagePixelViewer.h"
+
+static void worker_loop(WorkerPool* pool) {
+	for (;;) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(pool->mutex);
+			pool->wake.wait(lock, [pool] { return pool->stopping || !pool->urgentJobs.empty() || !pool->jobs.empty(); });
+			if (pool->stopping) {
+				return;
+			}
+			std::deque<std::function<void()>>& queue = pool->urgentJobs.empty() ? pool->jobs : pool->urgentJobs;
+			job = std::move(queue.front());
+			queue.pop_front();
+		}
+		job();
+	}
+}
+
+int default_worker_count() {
+	// Leave one core for the GL thread.
+	const int cores = (int)std::thread::hardware_concurrency();
+	return std::max(1, cores - 1);
+}
+
+void start_worker_pool(WorkerPool& pool, int threadCount) {
+	pool.stopping = false;
+	for (int i = 0; i < threadCount; ++i) {
+		pool.threads.emplace_back(worker_loop, &pool);
+	}
+}
+
+// Urgent jobs (the image on screen) run before anything already queued.
+void submit_job(WorkerPool& pool, std::function<void()> job, bool urgent) {
+	{
+		std::lock_guard<std::mutex> lock(pool.mutex);
+		(urgent ? pool.urgentJobs : pool.jobs).push_back(std::move(job));
+	}
+	pool.wake.notify_one();
+}
+
+// Long-running jobs poll this so shutdown does not wait for a whole folder walk.
+bool worker_pool_stopping(WorkerPool& pool) {
+	std::lock_guard<std::mutex> lock(pool.mutex);
+	return pool.stopping;
+}
+
+void stop_worker_pool(WorkerPool& pool) {
+	{
+		std::lock_guard<std::mutex> lock(pool.mutex);
+		pool.stopping = true;
+		pool.jobs.clear();
+		pool.urgentJobs.clear();
+	}
+	pool.wake.notify_all();
+	for (auto& thread : pool.threads) {
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+	pool.threads.clear();
+}
+
+// Whether the entry is showing its own file rather than a frame or page inside it.
+static bool shows_own_file(const ImageState& state) {
+	return normalize_path(fs::path(state.currentPath)) == state.normalizedPath;
+}
+
+static void post_decode_result(DecodePipeline* decoder, DecodeResult&& result) {
+	{
+		std::lock_guard<std::mutex> lock(decoder->resultMutex);
+		decoder->results.push_back(std::move(result));
+	}
+	request_redraw();
+}
+
+static void submit_decode(ImageStates& states, ImageState& state, bool reload, bool fullResolution, bool urgent, bool prefetch) {
+	if (state.sequence && state.sequence->video) {
+		return; // frames come from the entry's own decoder thread
+	}
+	if (state.uid == 0) {
+		state.uid = states.nextUid++;
+	}
+	if (!reload || state.sourceOriginal.empty()) {
+		state.loadStatus = LoadStatus::Queued;
+	}
+
+	// Capture by value: the ImageState may move or be deleted while the job runs.
+	DecodePipeline* decoder = &states.decoder;
+	const std::uint64_t uid = state.uid;
+	const std::uint64_t serial = ++state.decodeSerial;
+	const std::string path = state.currentPath;
+	const PreviewOptions options = desired_preview_options(states);
+	const cv::Size proxyTarget = fullResolution ? cv::Size() : states.canvasSize;
+	const bool cacheThumbnail = shows_own_file(state);
+	submit_job(decoder->pool, [decoder, uid, serial, reload, prefetch, path, options, proxyTarget, cacheThumbnail]() {
+		DecodeResult started;
+		started.uid = uid;
+		started.serial = serial;
+		started.started = true;
+		post_decode_result(decoder, std::move(started));
+
+		DecodeResult result;
+		result.uid = uid;
+		result.serial = serial;
+		result.reload = reload;
+		result.prefetch = prefetch;
+		result.cacheThumbnail = cacheThumbnail;
+		result.options = options;
+		result.ok = decode_image_file(path, options, result, proxyTarget);
+		post_decode_result(decoder, std::move(result));
+	}, urgent);
+}
+
+// A reload keeps the current image on screen until the new pixels arrive. Without
+// `fullResolution` the worker may decode a reduced proxy sized for the canvas.
+void queue_image_decode(ImageStates& states, ImageState& state, bool reload, bool fullResolution, bool urgent) {
+	submit_decode(states, state, reload, fullResolution, urgent, false);
+}
+
+// Background decode of a neighbour of the selection. Only a few run at once, so flipping
+// quickly through a long sequence never buries the selected image behind stale prefetches.
+void queue_prefetch_decode(ImageStates& states, ImageState& state) {
+	const size_t maxInFlight = std::max<size_t>(1, states.decoder.pool.threads.size());
+	if (state.loadStatus != LoadStatus::Unloaded || states.prefetchDecodes.size() >= maxInFlight
+		|| (state.sequence && state.sequence->video)) {
+		return;
+	}
+	states.prefetchDecodes.insert(state.uid);
+	submit_decode(states, state, false, false, false, true);
+}
+
+// Decodes just enough of an Unloaded entry to show its thumbnail and metadata; the pixels
+// are dropped so scrolling through a large folder does not keep every image in memory.
+void queue_thumbnail_decode(ImageStates& states, ImageState& state) {
+	const size_t maxInFlight = std::max<size_t>(2, states.decoder.pool.threads.size() * 2);
+	if (state.loadStatus != LoadStatus::Unloaded || !state.thumbRGBA.empty() || state.thumbnailFailed
+		|| states.thumbnailDecodes.count(state.uid) != 0 || states.thumbnailDecodes.size() >= maxInFlight
+		|| (state.sequence && state.sequence->video)) {
+		return;
+	}
+	// .npz members are inflated only when selected; their thumbnail comes with that decode.
+	if (to_lower(fs::path(array_file_path(state.currentPath)).extension().string()) == ".npz") {
+		return;
+	}
+	states.thumbnailDecodes.insert(state.uid);
+
+	DecodePipeline* decoder = &states.decoder;
+	const std::uint64_t uid = state.uid;
+	const std::uint64_t serial = ++state.decodeSerial;
+	const std::string path = state.currentPath;
+	const PreviewOptions options = desired_preview_options(states);
+	const bool cacheThumbnail = shows_own_file(state);
+	submit_job(decoder->pool, [decoder, uid, serial, path, options, cacheThumbnail]() {
+		DecodeResult result;
+		result.uid = uid;
+		result.serial = serial;
+		result.thumbnailOnly = true;
+		result.cacheThumbnail = cacheThumbnail;
+		result.options = options;
+		result.ok = decode_image_file(path, options, result, cv::Size((int)thumbWidth, (int)thumbHeight));
+		result.preview.previewRGBA.release();
+		result.preview.pyramid.clear();
+		post_decode_result(decoder, std::move(result));
+	});
+}
+
+// Swaps a proxy for the full-resolution decode once, keeping the proxy on screen meanwhile.
+void request_full_resolution(ImageStates& states, ImageState& state) {
+	if (state.proxyScale <= 1 || state.fullResPending || state.sizeLimited || state.loadStatus != LoadStatus::Ready) {
+		return;
+	}
+	if (state.sequence && state.sequence->playing) {
+		return; // the next frame replaces it before it would land
+	}
+	state.fullResPending = true;
+	queue_image_decode(states, state, true, true, true);
+}
+
+// A size-limited TIFF never gets its full decode, but the strips or tiles around one pixel
+// are cheap to read. Queues the kExactTileSize-aligned window holding (x, y); false when
+// the entry has no such access.
+bool request_exact_tile(ImageStates& states, ImageState& state, int x, int y) {
+	const std::string filePath = entry_file_path(state.currentPath);
+	const std::string extLower = to_lower(fs::path(filePath).extension().string());
+	if (!state.sizeLimited || state.exactTileFailed || (extLower != ".tif" && extLower != ".tiff")) {
+		return false;
+	}
+	if (state.exactTilePending) {
+		return true;
+	}
+	const cv::Rect region = cv::Rect(x / kExactTileSize * kExactTileSize, y / kExactTileSize * kExactTileSize, kExactTileSize, kExactTileSize)
+		& cv::Rect(0, 0, state.width, state.height);
+	state.exactTilePending = true;
+	DecodePipeline* decoder = &states.decoder;
+	const std::uint64_t uid = state.uid;
+	const std::uint64_t serial = state.decodeSerial;
+	const int page = std::max(0, page_of_path(state.currentPath));
+	submit_job(decoder->pool, [decoder, uid, serial, filePath, page, region]() {
+		DecodeResult result;
+		result.uid = uid;
+		result.serial = serial;
+		result.region = region;
+		result.ok = read_tiff_region(filePath, page, region, result.source, result.error);
+		post_decode_result(decoder, std::move(result));
+	}, true);
+	return true;
+}
+
+static int find_state_by_uid(const ImageStates& states, std::uint64_t uid) {
+	for (int i = 0; i < (int)states.states.size(); ++i) {
+		if (states.states[i].uid == uid) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+// Called once per frame on the GL thread: uploads finished decodes and drops failed entries.
+void process_decode_results(ImageStates& states) {
+	std::vector<DecodeResult> results;
+	{
+		std::lock_guard<std::mutex> lock(states.decoder.resultMutex);
+		results.swap(states.decoder.results);
+	}
+
+	for (auto& result : results) {
+		if (result.thumbnailOnly) {
+			states.thumbnailDecodes.erase(result.uid);
+		}
+		if (result.prefetch) {
+			states.prefetchDecodes.erase(result.uid);
+		}
+		const int index = find_state_by_uid(states, result.uid);
+		if (index < 0) {
+			continue; // deleted while decoding
+		}
+		ImageState& state = states.states[index];
+		if (result.sequenceFrame >= 0) {
+			store_sequence_frame(state, result);
+			continue;
+		}
+		if (!result.region.empty()) {
+			state.exactTilePending = false;
+			if (result.serial != state.decodeSerial) {
+				continue;
+			}
+			if (!result.ok) {
+				std::fprintf(stderr, "Full-resolution read failed: %s\n", result.error.c_str());
+				state.exactTileFailed = true;
+				continue;
+			}
+			state.exactTile = result.source;
+			state.exactTileRect = result.region;
+			continue;
+		}
+		if (result.serial != state.decodeSerial) {
+			continue; // superseded by a newer reload
+		}
+		if (result.thumbnailOnly) {
+			if (!result.ok) {
+				std::fprintf(stderr, "Thumbnail decode failed: %s\n", result.error.c_str());
+				state.thumbnailFailed = true;
+				continue;
+			}
+			state.width = result.fullWidth;
+			state.height = result.fullHeight;
+			state.channels = result.source.channels();
+			state.depth = depth_to_string(result.source.depth());
+			state.thumbRGBA = result.preview.thumbRGBA;
+			state.previewVersion++;
+			if (result.pageCount > 1 && !state.sequence) {
+				open_page_stack(state, result.pageCount, nullptr);
+			}
+			continue;
+		}
+		if (result.started) {
+			if (state.loadStatus == LoadStatus::Queued) {
+				state.loadStatus = LoadStatus::Decoding;
+			}
+			continue;
+		}
+
+		if (result.reload && !result.ok) {
+			// Keep showing the last good pixels; the writer may not be done yet.
+			std::fprintf(stderr, "Reload failed: %s\n", result.error.c_str());
+			continue;
+		}
+
+		const bool wasFit = state.fitToWindow;
+		const float oldZoom = state.zoom;
+		const float oldMinZoom = state.minZoom;
+		const ImVec2 oldPan = state.pan;
+
+		// A multi-page file becomes a page stack; this decode is its first cached page.
+		// Copying the result shares its Mats, it does not copy pixels.
+		const bool opensPages = result.ok && result.pageCount > 1 && !state.sequence;
+		const DecodeResult firstPage = opensPages ? result : DecodeResult();
+
+		std::string applyError;
+		if (result.ok && apply_decoded_image(state, result, applyError)) {
+			state.loadStatus = LoadStatus::Ready;
+			activate_watch(states.watcher, array_file_path(state.normalizedPath));
+			if (opensPages) {
+				open_page_stack(state, result.pageCount, &firstPage);
+			}
+			if (result.reload) {
+				if (wasFit) {
+					state.fitToWindow = true;
+					state.minZoom = -1.0f;
+				}
+				else {
+					state.fitToWindow = false;
+					state.zoom = oldZoom;
+					state.pan = oldPan;
+					state.minZoom = oldMinZoom;
+				}
+			}
+			continue;
+		}
+		if (result.reload) {
+			std::fprintf(stderr, "Reload failed: %s\n", applyError.c_str());
+			continue;
+		}
+
+		const std::string message = result.ok ? applyError : result.error;
+		remove_image_at(states, index);
+		showError(message.c_str());
+	}
+}
+
+void cancel_stale_previews(ImageStates& states) {
+	states.decoder.previewGeneration++;
+}
+
+static void request_preview(ImageStates& states, ImageState& state, const PreviewOptions& desired, bool urgent) {
+	if (state.loadStatus != LoadStatus::Ready || state.sourceOriginal.empty()) {
+		return;
+	}
+	if (preview_options_of(state) == desired) {
+		return;
+	}
+	if (state.previewPending && state.pendingOptions == desired) {
+		return; // already in flight
+	}
+
+	state.previewPending = true;
+	state.pendingOptions = desired;
+
+	// Mats are reference counted, so the job shares the pixels without copying them.
+	DecodePipeline* decoder = &states.decoder;
+	const std::uint64_t uid = state.uid;
+	const std::uint64_t serial = ++state.previewSerial;
+	const std::uint64_t decodeSerial = state.decodeSerial;
+	const cv::Mat source = state.sourceOriginal;
+	const ImageStats stats = state.stats;
+	CancelToken cancel;
+	cancel.generation = &decoder->previewGeneration;
+	cancel.expected = decoder->previewGeneration.load();
+	submit_job(decoder->pool, [decoder, uid, serial, decodeSerial, source, stats, desired, cancel]() {
+		PreviewResult result;
+		result.uid = uid;
+		result.serial = serial;
+		result.decodeSerial = decodeSerial;
+		result.options = desired;
+		result.cancelled = cancel.requested();
+		if (!result.cancelled) {
+			result.ok = build_preview_images(source, stats, desired, result.preview, result.error, cancel);
+			result.cancelled = !result.ok && cancel.requested();
+		}
+		{
+			std::lock_guard<std::mutex> lock(decoder->resultMutex);
+			decoder->previewResults.push_back(std::move(result));
+		}
+		request_redraw();
+	}, urgent);
+}
+
+// Visible-first: the selected image jumps the queue, images that were looked at before or
+// sit in the prefetch window rebuild in the background, and the rest wait until selected.
+void schedule_preview_rebuilds(ImageStates& states) {
+	if (states.states.empty()) {
+		return;
+	}
+	const PreviewOptions desired = desired_preview_options(states);
+	request_preview(states, states.states[states.selected], desired, true);
+	for (int i = 0; i < (int)states.states.size(); ++i) {
+		const bool nearSelection = std::abs(i - states.selected) <= states.prefetchRadius;
+		if (i != states.selected && (states.states[i].viewed || nearSelection)) {
+			request_preview(states, states.states[i], desired, false);
+		}
+	}
+}
+
+void process_preview_results(ImageStates& states) {
+	std::vector<PreviewResult> results;
+	{
+		std::lock_guard<std::mutex> lock(states.decoder.resultMutex);
+		results.swap(states.decoder.previewResults);
+	}
+
+	for (auto& result : results) {
+		const int index = find_state_by_uid(states, result.uid);
+		if (index < 0) {
+			continue;
+		}
+		ImageState& state = states.states[index];
+		if (result.serial != state.previewSerial) {
+			continue; // superseded by a newer request
+		}
+		state.previewPending = false;
+		if (result.cancelled || result.decodeSerial != state.decodeSerial) {
+			continue; // the scheduler re-requests it if still needed
+		}
+		if (!result.ok) {
+			std::fprintf(stderr, "Preview rebuild failed for %s: %s\n", state.filename.c_str(), result.error.c_str());
+			// Record the options anyway so a failing mode is not retried every frame.
+			state.grayApplied = result.options.gray;
+			state.autoContrastApplied = result.options.autoContrast;
+			state.pseudoColorApplied = result.options.pseudoColor;
+			state.ignoreAlphaApplied = result.options.ignoreAlpha;
+			state.pyramidKeepExtremesApplied = result.options.pyramidKeepExtremes;
+			continue;
+		}
+		std::string applyError;
+		if (!apply_preview_images(state, result.preview, result.options, applyError)) {
+			std::fprintf(stderr, "Preview upload failed for %s: %s\n", state.filename.c_str(), applyError.c_str());
+		}
+	}
+}